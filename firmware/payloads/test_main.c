@@ -51,10 +51,471 @@ static inline void sbi_ecall_console_puts(const char *str)
 		__asm__ __volatile__("wfi" ::: "memory"); \
 	} while (0)
 
+#define rdcycle()                                                \
+	({                                                       \
+		unsigned long __v;                               \
+		__asm__ __volatile__("rdcycle %0" : "=r"(__v)); \
+		__v;                                             \
+	})
+
+#define BENCH_ROUNDS	256
+
+static void test_puts_ulong(unsigned long val)
+{
+	char buf[24];
+	int pos = sizeof(buf) - 1;
+
+	buf[pos] = '\0';
+	do {
+		buf[--pos] = '0' + (val % 10);
+		val /= 10;
+	} while (val && pos);
+
+	sbi_ecall_console_puts(&buf[pos]);
+}
+
+/* Print minimum and average ecall round-trip latency in cycles */
+static void test_bench_ecall(const char *name, int ext, int fid,
+			     unsigned long arg0, unsigned long arg1)
+{
+	unsigned long i, start, delta, min = -1UL, total = 0;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = rdcycle();
+		sbi_ecall(ext, fid, arg0, arg1, 0, 0, 0, 0);
+		delta = rdcycle() - start;
+		total += delta;
+		if (delta < min)
+			min = delta;
+	}
+
+	sbi_ecall_console_puts(name);
+	sbi_ecall_console_puts(": min ");
+	test_puts_ulong(min);
+	sbi_ecall_console_puts(" avg ");
+	test_puts_ulong(total / BENCH_ROUNDS);
+	sbi_ecall_console_puts(" cycles\n");
+}
+
+/*
+ * Time ecall round trips of the hot extensions with the firmware looking
+ * up extensions in its range table and with the registration list walk.
+ * The calls target no hart so that the lookup is a visible part of the
+ * round trip. sbi_set_timer is left out as its fast path skips the lookup.
+ */
+static void test_bench_ecall_lookup(void)
+{
+	struct sbiret ret;
+	int table;
+
+	for (table = 1; table >= 0; table--) {
+		ret = sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_TUNABLE_SET,
+				SBI_OPENSBI_TUNABLE_ECALL_TABLE, table,
+				0, 0, 0, 0);
+		if (ret.error)
+			return;
+
+		sbi_ecall_console_puts(table ? "ecall lookup: table\n" :
+					       "ecall lookup: list\n");
+		test_bench_ecall("sbi_send_ipi", SBI_EXT_IPI,
+				 SBI_EXT_IPI_SEND_IPI, 0, 0);
+		test_bench_ecall("sbi_remote_fence_i", SBI_EXT_RFENCE,
+				 SBI_EXT_RFENCE_REMOTE_FENCE_I, 0, 0);
+		test_bench_ecall("sbi_pmu_num_counters", SBI_EXT_PMU,
+				 SBI_EXT_PMU_NUM_COUNTERS, 0, 0);
+		test_bench_ecall("sbi_get_spec_version", SBI_EXT_BASE,
+				 SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0);
+	}
+
+	sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_TUNABLE_SET,
+		  SBI_OPENSBI_TUNABLE_ECALL_TABLE, 1, 0, 0, 0, 0);
+}
+
+static unsigned long test_misaligned_buf[4];
+
+/* Print average cycles per emulated misaligned register load and store */
+static void test_bench_misaligned(void)
+{
+	volatile unsigned long *ptr =
+		(void *)((char *)test_misaligned_buf + 1);
+	unsigned long i, start, ld_cycles, sd_cycles, val = 0;
+
+	start = rdcycle();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		val += *ptr;
+	ld_cycles = rdcycle() - start;
+
+	start = rdcycle();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		*ptr = val + i;
+	sd_cycles = rdcycle() - start;
+
+	sbi_ecall_console_puts("misaligned load: avg ");
+	test_puts_ulong(ld_cycles / BENCH_ROUNDS);
+	sbi_ecall_console_puts(" cycles\nmisaligned store: avg ");
+	test_puts_ulong(sd_cycles / BENCH_ROUNDS);
+	sbi_ecall_console_puts(" cycles\n");
+}
+
+#define TEST_BOOT_STACK_SIZE	0x2000
+#define TEST_STACK_SIZE		2048
+#define TEST_FENCE_ADDR		0x80000000UL
+#define TEST_FENCE_SIZE		0x4000UL
+
+#define TEST_FDT_MAGIC		0xd00dfeed
+#define TEST_FDT_BEGIN_NODE	0x1
+#define TEST_FDT_END_NODE	0x2
+#define TEST_FDT_PROP		0x3
+#define TEST_FDT_NOP		0x4
+
+extern char _payload_end[];
+extern char _start_secondary[];
+
+static unsigned long test_free;
+static unsigned long *test_hartids;
+static unsigned long test_hart_count = 1;
+
+static unsigned long test_fence_errors;
+static unsigned long test_fence_worst;
+
+static void (*test_work)(void);
+static unsigned long test_work_gen;
+static unsigned long test_work_done;
+
+static unsigned int test_fdt32(const void *fdt, unsigned long off)
+{
+	const unsigned char *p = (const unsigned char *)fdt + off;
+
+	return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+	       ((unsigned int)p[2] << 8) | p[3];
+}
+
+/*
+ * Walk the FDT structure block and store the hartid of every enabled
+ * /cpus/cpu@ node in hartids, unless it is NULL. Returns the number of
+ * harts found.
+ */
+static unsigned long test_fdt_hartids(const void *fdt,
+				      unsigned long *hartids)
+{
+	unsigned long off, strings, len, hartid = -1UL, count = 0;
+	int depth = 0, in_cpus = 0, in_cpu = 0, enabled = 1;
+	const char *name, *value;
+
+	if (!fdt || test_fdt32(fdt, 0) != TEST_FDT_MAGIC)
+		return 0;
+
+	off = test_fdt32(fdt, 8);
+	strings = test_fdt32(fdt, 12);
+	while (1) {
+		switch (test_fdt32(fdt, off)) {
+		case TEST_FDT_BEGIN_NODE:
+			name = (const char *)fdt + off + 4;
+			off += 4 + ((sbi_strlen(name) + 4) & ~3UL);
+			depth++;
+			if (depth == 2 && !sbi_strcmp(name, "cpus")) {
+				in_cpus = 1;
+			} else if (depth == 3 && in_cpus &&
+				   !sbi_strncmp(name, "cpu@", 4)) {
+				in_cpu = 1;
+				enabled = 1;
+				hartid = -1UL;
+			}
+			break;
+		case TEST_FDT_END_NODE:
+			off += 4;
+			if (depth == 3 && in_cpu) {
+				if (enabled && hartid != -1UL) {
+					if (hartids)
+						hartids[count] = hartid;
+					count++;
+				}
+				in_cpu = 0;
+			} else if (depth == 2) {
+				in_cpus = 0;
+			}
+			depth--;
+			break;
+		case TEST_FDT_PROP:
+			len = test_fdt32(fdt, off + 4);
+			name = (const char *)fdt + strings +
+			       test_fdt32(fdt, off + 8);
+			value = (const char *)fdt + off + 12;
+			off += 12 + ((len + 3) & ~3UL);
+			if (depth != 3 || !in_cpu)
+				break;
+			/* The last cell of reg is enough for the hartid */
+			if (!sbi_strcmp(name, "reg") && len >= 4)
+				hartid = test_fdt32(value, len - 4);
+			else if (!sbi_strcmp(name, "status") &&
+				 sbi_strcmp(value, "okay") &&
+				 sbi_strcmp(value, "ok"))
+				enabled = 0;
+			break;
+		case TEST_FDT_NOP:
+			off += 4;
+			break;
+		default:
+			return count;
+		}
+	}
+}
+
+/* Carve memory above the boot hart stack, skipping the FDT */
+static void *test_alloc(const void *fdt, unsigned long size)
+{
+	unsigned long fdt_start = (unsigned long)fdt;
+	unsigned long fdt_end = fdt_start + test_fdt32(fdt, 4);
+	unsigned long addr;
+
+	if (!test_free)
+		test_free = (unsigned long)_payload_end + TEST_BOOT_STACK_SIZE;
+
+	addr = (test_free + 15) & ~15UL;
+	if (addr < fdt_end && fdt_start < addr + size)
+		addr = (fdt_end + 15) & ~15UL;
+	test_free = addr + size;
+
+	return (void *)addr;
+}
+
+void test_secondary_main(unsigned long hartid, unsigned long opaque)
+{
+	unsigned long gen = 0;
+
+	while (1) {
+		while (__atomic_load_n(&test_work_gen, __ATOMIC_ACQUIRE) == gen)
+			;
+		gen++;
+		test_work();
+		__atomic_fetch_add(&test_work_done, 1, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ * Start every other hart of the FDT with a stack of its own. Secondary
+ * harts spin in test_secondary_main() so that they take firmware IPIs
+ * without any supervisor interrupt handling.
+ */
+static void test_start_harts(unsigned long boot_hartid, const void *fdt)
+{
+	unsigned long i, count, started = 0;
+	char *stack;
+	struct sbiret ret;
+
+	count = test_fdt_hartids(fdt, NULL);
+	if (count < 2)
+		return;
+
+	test_hartids = test_alloc(fdt, count * sizeof(*test_hartids));
+	test_fdt_hartids(fdt, test_hartids);
+
+	for (i = 0; i < count; i++) {
+		if (test_hartids[i] == boot_hartid)
+			continue;
+
+		ret = sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_GET_STATUS,
+				test_hartids[i], 0, 0, 0, 0, 0);
+		if (ret.error || ret.value != SBI_HSM_STATE_STOPPED)
+			continue;
+
+		stack = test_alloc(fdt, TEST_STACK_SIZE);
+		ret = sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_START,
+				test_hartids[i], (unsigned long)_start_secondary,
+				(unsigned long)(stack + TEST_STACK_SIZE),
+				0, 0, 0);
+		if (!ret.error)
+			test_hartids[started++] = test_hartids[i];
+	}
+
+	/* Wait for the started harts to be able to take IPIs */
+	for (i = 0; i < started; i++) {
+		do {
+			ret = sbi_ecall(SBI_EXT_HSM,
+					SBI_EXT_HSM_HART_GET_STATUS,
+					test_hartids[i], 0, 0, 0, 0, 0);
+		} while (!ret.error && ret.value == SBI_HSM_STATE_START_PENDING);
+	}
+
+	test_hart_count = started + 1;
+}
+
+/* Run work on every started hart, returns the cycles taken on this hart */
+static unsigned long test_run_all(void (*work)(void))
+{
+	unsigned long start, cycles;
+
+	test_work = work;
+	__atomic_store_n(&test_work_done, 0, __ATOMIC_RELAXED);
+	start = rdcycle();
+	__atomic_fetch_add(&test_work_gen, 1, __ATOMIC_RELEASE);
+	work();
+	cycles = rdcycle() - start;
+
+	while (__atomic_load_n(&test_work_done, __ATOMIC_ACQUIRE) !=
+	       test_hart_count - 1)
+		;
+
+	return cycles;
+}
+
+static void test_puts_bench(const char *name, const char *mode,
+			    unsigned long cycles)
+{
+	sbi_ecall_console_puts(name);
+	sbi_ecall_console_puts(", ");
+	test_puts_ulong(test_hart_count);
+	sbi_ecall_console_puts(" harts, ");
+	sbi_ecall_console_puts(mode);
+	sbi_ecall_console_puts(": avg ");
+	test_puts_ulong(cycles / BENCH_ROUNDS);
+	sbi_ecall_console_puts(" cycles\n");
+}
+
+/* Fence every hart, including the ones doing the same at the same time */
+static void test_fence_all(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		sbi_ecall(SBI_EXT_RFENCE, SBI_EXT_RFENCE_REMOTE_SFENCE_VMA,
+			  0, -1UL, TEST_FENCE_ADDR, TEST_FENCE_SIZE, 0, 0);
+}
+
+static void test_ipi_all(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		sbi_ecall(SBI_EXT_IPI, SBI_EXT_IPI_SEND_IPI, 0, -1UL,
+			  0, 0, 0, 0);
+}
+
+/*
+ * Time an all-harts remote SFENCE.VMA and an all-harts S-mode IPI sent
+ * by the boot hart alone, then let every hart fence all harts at the
+ * same time, so that the delivery trees of the senders cross when the
+ * firmware forwards IPIs through cluster leaders. Getting past the
+ * latter shows that crossing senders make progress.
+ */
+static void test_bench_delivery(const char *mode)
+{
+	unsigned long start, cycles;
+
+	start = rdcycle();
+	test_fence_all();
+	cycles = rdcycle() - start;
+	test_puts_bench("remote sfence.vma", mode, cycles);
+
+	start = rdcycle();
+	test_ipi_all();
+	cycles = rdcycle() - start;
+	test_puts_bench("sbi_send_ipi", mode, cycles);
+
+	cycles = test_run_all(test_fence_all);
+	test_puts_bench("cross remote sfence.vma", mode, cycles);
+}
+
+/*
+ * Compare direct IPI delivery against delivery through cluster leaders
+ * (CONFIG_SBI_IPI_TREE_MIN_HARTS, for example 4 on QEMU virt with
+ * -smp 64,sockets=8). The tree threshold is lowered to zero through the
+ * OpenSBI tunable for the direct run and restored afterwards. Only
+ * direct delivery is timed when the firmware has no tree support.
+ */
+static void test_bench_ipi(unsigned long boot_hartid, const void *fdt)
+{
+	unsigned long tree_min_harts;
+	struct sbiret ret;
+
+	test_start_harts(boot_hartid, fdt);
+
+	ret = sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_TUNABLE_SET,
+			SBI_OPENSBI_TUNABLE_IPI_TREE_MIN_HARTS, 0, 0, 0, 0, 0);
+	test_bench_delivery("direct");
+	if (ret.error || !ret.value)
+		return;
+
+	tree_min_harts = ret.value;
+	sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_TUNABLE_SET,
+		  SBI_OPENSBI_TUNABLE_IPI_TREE_MIN_HARTS, tree_min_harts,
+		  0, 0, 0, 0);
+	test_bench_delivery("tree");
+}
+
+/* Fence every hart with remote fences of every type a supervisor can issue */
+static void test_fence_mixed(void)
+{
+	unsigned long i, fid, start, delta, worst = 0, old;
+	struct sbiret ret;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		switch (i % 3) {
+		case 0:
+			fid = SBI_EXT_RFENCE_REMOTE_SFENCE_VMA;
+			break;
+		case 1:
+			fid = SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID;
+			break;
+		default:
+			fid = SBI_EXT_RFENCE_REMOTE_FENCE_I;
+			break;
+		}
+
+		start = rdcycle();
+		ret = sbi_ecall(SBI_EXT_RFENCE, fid, 0, -1UL, TEST_FENCE_ADDR,
+				(i % 8 + 1) * 0x1000, i & 0xff, 0);
+		delta = rdcycle() - start;
+
+		if (ret.error)
+			__atomic_fetch_add(&test_fence_errors, 1,
+					   __ATOMIC_RELAXED);
+		if (delta > worst)
+			worst = delta;
+	}
+
+	old = __atomic_load_n(&test_fence_worst, __ATOMIC_RELAXED);
+	while (worst > old &&
+	       !__atomic_compare_exchange_n(&test_fence_worst, &old, worst, 0,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/*
+ * Let every started hart issue back to back remote fences of mixed types
+ * to all harts at the same time and check that every request completes.
+ * The average latency on the boot hart and the worst latency seen by any
+ * hart are printed.
+ */
+static void test_cross_fence(void)
+{
+	unsigned long cycles = test_run_all(test_fence_mixed);
+
+	sbi_ecall_console_puts("mixed cross remote fences, ");
+	test_puts_ulong(test_hart_count);
+	sbi_ecall_console_puts(" harts: avg ");
+	test_puts_ulong(cycles / BENCH_ROUNDS);
+	sbi_ecall_console_puts(" cycles, worst ");
+	test_puts_ulong(test_fence_worst);
+	sbi_ecall_console_puts(" cycles, ");
+	test_puts_ulong(test_fence_errors);
+	sbi_ecall_console_puts(" errors\n");
+}
+
 void test_main(unsigned long a0, unsigned long a1)
 {
 	sbi_ecall_console_puts("\nTest payload running\n");
 
+	/* Program the timer far into the future so it never fires */
+	test_bench_ecall("sbi_set_timer", SBI_EXT_TIME, SBI_EXT_TIME_SET_TIMER,
+			 -1UL, -1UL);
+	test_bench_ecall("sbi_get_spec_version", SBI_EXT_BASE,
+			 SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0);
+	test_bench_ecall_lookup();
+	test_bench_misaligned();
+	test_bench_ipi(a0, (const void *)a1);
+	test_cross_fence();
+
 	while (1)
 		wfi();
 }
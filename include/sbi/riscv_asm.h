@@ -165,6 +165,18 @@ void csr_write_num(int csr_num, unsigned long val);
 		__asm__ __volatile__("wfi" ::: "memory"); \
 	} while (0)
 
+/* Zawrs wrs.nto (encoded for toolchains without Zawrs support) */
+#define wrs_nto()                                                   \
+	do {                                                        \
+		__asm__ __volatile__(".word 0x00d00073" ::: "memory"); \
+	} while (0)
+
+/* Zawrs wrs.sto (encoded for toolchains without Zawrs support) */
+#define wrs_sto()                                                   \
+	do {                                                        \
+		__asm__ __volatile__(".word 0x01d00073" ::: "memory"); \
+	} while (0)
+
 #define ebreak()                                             \
 	do {                                              \
 		__asm__ __volatile__("ebreak" ::: "memory"); \
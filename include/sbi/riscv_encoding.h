@@ -120,9 +120,11 @@
 
 #define SATP32_MODE			_UL(0x80000000)
 #define SATP32_ASID			_UL(0x7FC00000)
+#define SATP32_ASID_SHIFT		22
 #define SATP32_PPN			_UL(0x003FFFFF)
 #define SATP64_MODE			_ULL(0xF000000000000000)
 #define SATP64_ASID			_ULL(0x0FFFF00000000000)
+#define SATP64_ASID_SHIFT		44
 #define SATP64_PPN			_ULL(0x00000FFFFFFFFFFF)
 
 #define SATP_MODE_OFF			_UL(0)
@@ -168,6 +170,8 @@
 #define MSTATUS_SD			MSTATUS64_SD
 #define SSTATUS_SD			SSTATUS64_SD
 #define SATP_MODE			SATP64_MODE
+#define SATP_ASID			SATP64_ASID
+#define SATP_ASID_SHIFT			SATP64_ASID_SHIFT
 
 #define HGATP_PPN			HGATP64_PPN
 #define HGATP_VMID_SHIFT		HGATP64_VMID_SHIFT
@@ -177,6 +181,8 @@
 #define MSTATUS_SD			MSTATUS32_SD
 #define SSTATUS_SD			SSTATUS32_SD
 #define SATP_MODE			SATP32_MODE
+#define SATP_ASID			SATP32_ASID
+#define SATP_ASID_SHIFT			SATP32_ASID_SHIFT
 
 #define HGATP_PPN			HGATP32_PPN
 #define HGATP_VMID_SHIFT		HGATP32_VMID_SHIFT
@@ -258,6 +264,12 @@
 #define CSR_FRM				0x002
 #define CSR_FCSR			0x003
 
+/* User Vector CSRs */
+#define CSR_VSTART			0x008
+#define CSR_VL				0xc20
+#define CSR_VTYPE			0xc21
+#define CSR_VLENB			0xc22
+
 /* User Counters/Timers */
 #define CSR_CYCLE			0xc00
 #define CSR_TIME			0xc01
@@ -885,6 +897,25 @@
 #define INSN_MATCH_C_SH		0x8c00
 #define INSN_MASK_C_SH			0xfc43
 
+/* Vector unit-stride loads and stores without segments */
+#define INSN_MATCH_VLE8			0x00000007
+#define INSN_MASK_VLE8			0xfdf0707f
+#define INSN_MATCH_VLE16		0x00005007
+#define INSN_MASK_VLE16			0xfdf0707f
+#define INSN_MATCH_VLE32		0x00006007
+#define INSN_MASK_VLE32			0xfdf0707f
+#define INSN_MATCH_VLE64		0x00007007
+#define INSN_MASK_VLE64			0xfdf0707f
+#define INSN_MATCH_VSE8			0x00000027
+#define INSN_MASK_VSE8			0xfdf0707f
+#define INSN_MATCH_VSE16		0x00005027
+#define INSN_MASK_VSE16			0xfdf0707f
+#define INSN_MATCH_VSE32		0x00006027
+#define INSN_MASK_VSE32			0xfdf0707f
+#define INSN_MATCH_VSE64		0x00007027
+#define INSN_MASK_VSE64			0xfdf0707f
+#define INSN_V_VM_SHIFT			25
+
 #define INSN_MASK_WFI			0xffffff00
 #define INSN_MATCH_WFI			0x10500000
 
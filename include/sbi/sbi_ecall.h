@@ -27,6 +27,30 @@ struct sbi_ecall_return {
 	unsigned long value;
 };
 
+/** Descriptor of one SBI call in a batch ring */
+struct sbi_ecall_batch_entry {
+	/* Extension and function ID of the call, as in A7 and A6 */
+	unsigned long extid;
+	unsigned long funcid;
+	/* Call arguments, as in A0 to A5 */
+	unsigned long args[6];
+	/* Call result written back by OpenSBI, as in A0 and A1 */
+	long error;
+	unsigned long value;
+};
+
+/** Batch ring shared with S-mode */
+struct sbi_ecall_batch_ring {
+	/* Free running index of the next entry run by OpenSBI */
+	unsigned long head;
+	/* Free running index of the next entry queued by S-mode */
+	unsigned long tail;
+	struct sbi_ecall_batch_entry entries[];
+};
+
+/** Maximum number of entries in a batch ring */
+#define SBI_ECALL_BATCH_MAX_ENTRIES	256
+
 struct sbi_ecall_extension {
 	/* head is used by the extension list */
 	struct sbi_dlist head;
@@ -83,12 +107,22 @@ void sbi_ecall_set_impid(unsigned long impid);
 
 struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid);
 
+void sbi_ecall_set_table_lookup(u32 enable, u32 *old_enable);
+
 int sbi_ecall_register_extension(struct sbi_ecall_extension *ext);
 
 void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext);
 
 int sbi_ecall_handler(struct sbi_trap_context *tcntx);
 
+int sbi_ecall_fast_set_timer(unsigned long next_lo, unsigned long next_hi);
+
+int sbi_ecall_batch_register(unsigned long phys_lo, unsigned long phys_hi,
+			     unsigned long num_entries);
+
+int sbi_ecall_batch_submit(const struct sbi_trap_regs *regs,
+			   struct sbi_ecall_return *out);
+
 int sbi_ecall_init(void);
 
 #endif
@@ -35,6 +35,7 @@
 #define SBI_EXT_DBTR				0x44425452
 #define SBI_EXT_SSE				0x535345
 #define SBI_EXT_FWFT				0x46574654
+#define SBI_EXT_OPENSBI				0x0A000001
 
 /* SBI function IDs for BASE extension*/
 #define SBI_EXT_BASE_GET_SPEC_VERSION		0x0
@@ -122,6 +123,7 @@
 #define SBI_EXT_FWFT_SET		0x0
 #define SBI_EXT_FWFT_GET		0x1
 
+#ifndef __ASSEMBLER__
 enum sbi_fwft_feature_t {
 	SBI_FWFT_MISALIGNED_EXC_DELEG		= 0x0,
 	SBI_FWFT_LANDING_PAD			= 0x1,
@@ -139,12 +141,14 @@ enum sbi_fwft_feature_t {
 	SBI_FWFT_GLOBAL_PLATFORM_START		= 0xc0000000,
 	SBI_FWFT_GLOBAL_PLATFORM_END		= 0xffffffff,
 };
+#endif
 
 #define SBI_FWFT_GLOBAL_FEATURE_BIT		(1 << 31)
 #define SBI_FWFT_PLATFORM_FEATURE_BIT		(1 << 30)
 
 #define SBI_FWFT_SET_FLAG_LOCK			(1 << 0)
 
+#ifndef __ASSEMBLER__
 /** General pmu event codes specified in SBI PMU extension */
 enum sbi_pmu_hw_generic_events_t {
 	SBI_PMU_HW_NO_EVENT			= 0,
@@ -232,6 +236,15 @@ enum sbi_pmu_fw_event_code_id {
 	 * Event codes 256 to 65534 are reserved for SBI implementation
 	 * specific custom firmware events.
 	 */
+	SBI_PMU_FW_IMPL_START		= 256,
+	SBI_PMU_FW_RFENCE_MERGED	= SBI_PMU_FW_IMPL_START,
+	SBI_PMU_FW_HFENCE_MERGED	= 257,
+	SBI_PMU_FW_HFENCE_VMID_PROMOTED	= 258,
+	SBI_PMU_FW_RFENCE_SKIPPED	= 259,
+	SBI_PMU_FW_RFENCE_FOLDED	= 260,
+	SBI_PMU_FW_LDST_DECODE_HIT	= 261,
+	SBI_PMU_FW_LDST_DECODE_MISS	= 262,
+	SBI_PMU_FW_IMPL_MAX,
 	SBI_PMU_FW_RESERVED_MAX = 0xFFFE,
 	/*
 	 * Event code 0xFFFF is used for platform specific firmware
@@ -254,6 +267,7 @@ enum sbi_pmu_ctr_type {
 	SBI_PMU_CTR_TYPE_HW = 0,
 	SBI_PMU_CTR_TYPE_FW,
 };
+#endif
 
 /* Helper macros to decode event idx */
 #define SBI_PMU_EVENT_IDX_MASK 0xFFFFF
@@ -306,6 +320,7 @@ enum sbi_pmu_ctr_type {
 #define SBI_EXT_CPPC_READ_HI			0x2
 #define SBI_EXT_CPPC_WRITE			0x3
 
+#ifndef __ASSEMBLER__
 enum sbi_cppc_reg_id {
 	SBI_CPPC_HIGHEST_PERF		= 0x00000000,
 	SBI_CPPC_NOMINAL_PERF		= 0x00000001,
@@ -332,6 +347,7 @@ enum sbi_cppc_reg_id {
 	SBI_CPPC_TRANSITION_LATENCY	= 0x80000000,
 	SBI_CPPC_NON_ACPI_LAST		= SBI_CPPC_TRANSITION_LATENCY,
 };
+#endif
 
 /* SBI Function IDs for SSE extension */
 #define SBI_EXT_SSE_READ_ATTR		0x00000000
@@ -345,6 +361,7 @@ enum sbi_cppc_reg_id {
 #define SBI_EXT_SSE_HART_UNMASK		0x00000008
 #define SBI_EXT_SSE_HART_MASK		0x00000009
 
+#ifndef __ASSEMBLER__
 /* SBI SSE Event Attributes. */
 enum sbi_sse_attr_id {
 	SBI_SSE_ATTR_STATUS		= 0x00000000,
@@ -379,6 +396,7 @@ enum sbi_sse_state {
 	SBI_SSE_STATE_ENABLED		= 2,
 	SBI_SSE_STATE_RUNNING		= 3,
 };
+#endif
 
 /* SBI SSE Event IDs. */
 #define SBI_SSE_EVENT_LOCAL_RAS			0x00000000
@@ -410,6 +428,20 @@ enum sbi_sse_state {
 #define SBI_SSE_EVENT_GLOBAL_BIT		(1 << 15)
 #define SBI_SSE_EVENT_PLATFORM_BIT		(1 << 14)
 
+/* SBI function IDs for OpenSBI firmware specific extension */
+#define SBI_EXT_OPENSBI_TLB_RESIDENCY_ENABLE	0x0
+#define SBI_EXT_OPENSBI_TLB_RESIDENCY_HINT	0x1
+#define SBI_EXT_OPENSBI_RFENCE_STATS_READ	0x2
+#define SBI_EXT_OPENSBI_RFENCE_STATS_RESET	0x3
+#define SBI_EXT_OPENSBI_BATCH_REGISTER		0x4
+#define SBI_EXT_OPENSBI_BATCH_SUBMIT		0x5
+#define SBI_EXT_OPENSBI_TRAP_TRACE_READ		0x6
+#define SBI_EXT_OPENSBI_TUNABLE_SET		0x7
+
+/* Tunable IDs for SBI_EXT_OPENSBI_TUNABLE_SET */
+#define SBI_OPENSBI_TUNABLE_IPI_TREE_MIN_HARTS	0x0
+#define SBI_OPENSBI_TUNABLE_ECALL_TABLE		0x1
+
 /* SBI base specification related macros */
 #define SBI_SPEC_VERSION_MAJOR_OFFSET		24
 #define SBI_SPEC_VERSION_MAJOR_MASK		0x7f
@@ -75,6 +75,10 @@ enum sbi_hart_extensions {
 	SBI_HART_EXT_ZICFISS,
 	/** Hart has Ssdbltrp extension */
 	SBI_HART_EXT_SSDBLTRP,
+	/** Hart has Svinval extension */
+	SBI_HART_EXT_SVINVAL,
+	/** Hart has Zawrs extension */
+	SBI_HART_EXT_ZAWRS,
 
 	/** Maximum index of Hart extension */
 	SBI_HART_EXT_MAX,
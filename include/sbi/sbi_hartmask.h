@@ -10,40 +10,84 @@
 #ifndef __SBI_HARTMASK_H__
 #define __SBI_HARTMASK_H__
 
+#include <sbi/riscv_atomic.h>
 #include <sbi/sbi_bitmap.h>
 #include <sbi/sbi_scratch.h>
 
 /**
  * Maximum number of bits in a hartmask
  *
- * The hartmask is indexed using physical HART id so this define
- * also represents the maximum number of HART ids generic OpenSBI
- * can handle.
+ * The hartmask is indexed using HART index so this define also
+ * represents the maximum number of HARTs generic OpenSBI can handle.
  */
+#ifdef CONFIG_SBI_HARTMASK_MAX_BITS
+#define SBI_HARTMASK_MAX_BITS		CONFIG_SBI_HARTMASK_MAX_BITS
+#else
 #define SBI_HARTMASK_MAX_BITS		128
+#endif
+
+/** Number of words in the bitmap of a hartmask */
+#define SBI_HARTMASK_WORDS		BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS)
 
-/** Representation of hartmask */
+/**
+ * Representation of hartmask
+ *
+ * Bit w of the summary is set if word w of the bitmap holds valid bits.
+ * Bitmap words without their summary bit are treated as zero, so clearing
+ * a hartmask and iterating over a sparse hartmask only touch the summary
+ * and the words having set bits.
+ */
 struct sbi_hartmask {
+	DECLARE_BITMAP(summary, SBI_HARTMASK_WORDS);
 	DECLARE_BITMAP(bits, SBI_HARTMASK_MAX_BITS);
 };
 
 /** Initialize hartmask to zero */
 #define SBI_HARTMASK_INIT(__m)		\
-	bitmap_zero(((__m)->bits), SBI_HARTMASK_MAX_BITS)
+	sbi_hartmask_clear_all(__m)
 
 /** Initialize hartmask to zero except a particular HART id */
 #define SBI_HARTMASK_INIT_EXCEPT(__m, __h)	\
 	do { \
-		u32 __i = sbi_hartid_to_hartindex(__h); \
-		bitmap_zero_except(((__m)->bits), __i, SBI_HARTMASK_MAX_BITS); \
+		sbi_hartmask_clear_all(__m); \
+		sbi_hartmask_set_hartid(__h, __m); \
 	} while(0)
 
 /**
  * Get underlying bitmap of hartmask
  * @param m the hartmask pointer
+ * Note: words of the bitmap are only valid if set in the summary
  */
 #define sbi_hartmask_bits(__m)		((__m)->bits)
 
+/**
+ * Get a word of the bitmap of a hartmask
+ * @param w word number
+ * @param m the hartmask pointer
+ */
+static inline unsigned long sbi_hartmask_word(u32 w,
+					      const struct sbi_hartmask *m)
+{
+	return __test_bit(w, m->summary) ? m->bits[w] : 0;
+}
+
+/**
+ * Write a word of the bitmap of a hartmask
+ * @param w word number
+ * @param val HART indices (w * BITS_PER_LONG) onwards to set
+ * @param m the hartmask pointer
+ */
+static inline void sbi_hartmask_write_word(u32 w, unsigned long val,
+					   struct sbi_hartmask *m)
+{
+	if (SBI_HARTMASK_WORDS <= w)
+		return;
+	if (w == SBI_HARTMASK_WORDS - 1)
+		val &= BITMAP_LAST_WORD_MASK(SBI_HARTMASK_MAX_BITS);
+	m->bits[w] = val;
+	__set_bit(w, m->summary);
+}
+
 /**
  * Set a HART index in hartmask
  * @param i HART index to set
@@ -51,8 +95,13 @@ struct sbi_hartmask {
  */
 static inline void sbi_hartmask_set_hartindex(u32 i, struct sbi_hartmask *m)
 {
-	if (i < SBI_HARTMASK_MAX_BITS)
+	if (i < SBI_HARTMASK_MAX_BITS) {
+		if (!__test_bit(BIT_WORD(i), m->summary)) {
+			m->bits[BIT_WORD(i)] = 0;
+			__set_bit(BIT_WORD(i), m->summary);
+		}
 		__set_bit(i, m->bits);
+	}
 }
 
 /**
@@ -72,7 +121,7 @@ static inline void sbi_hartmask_set_hartid(u32 h, struct sbi_hartmask *m)
  */
 static inline void sbi_hartmask_clear_hartindex(u32 i, struct sbi_hartmask *m)
 {
-	if (i < SBI_HARTMASK_MAX_BITS)
+	if (i < SBI_HARTMASK_MAX_BITS && __test_bit(BIT_WORD(i), m->summary))
 		__clear_bit(i, m->bits);
 }
 
@@ -86,6 +135,38 @@ static inline void sbi_hartmask_clear_hartid(u32 h, struct sbi_hartmask *m)
 	sbi_hartmask_clear_hartindex(sbi_hartid_to_hartindex(h), m);
 }
 
+/**
+ * Atomically set a HART index in hartmask
+ * @param i HART index to set
+ * @param m the hartmask pointer
+ * Note: the hartmask must be zero initialized and only be updated
+ * using the atomic helpers
+ */
+static inline void sbi_hartmask_atomic_set_hartindex(u32 i,
+						     struct sbi_hartmask *m)
+{
+	if (i < SBI_HARTMASK_MAX_BITS) {
+		atomic_raw_set_bit(i, m->bits);
+		/* Publish the bit before its summary bit */
+		__atomic_fetch_or(&m->summary[BIT_WORD(BIT_WORD(i))],
+				  BIT_MASK(BIT_WORD(i)), __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Atomically clear a HART index in hartmask
+ * @param i HART index to clear
+ * @param m the hartmask pointer
+ * Note: the hartmask must be zero initialized and only be updated
+ * using the atomic helpers
+ */
+static inline void sbi_hartmask_atomic_clear_hartindex(u32 i,
+						       struct sbi_hartmask *m)
+{
+	if (i < SBI_HARTMASK_MAX_BITS)
+		atomic_raw_clear_bit(i, m->bits);
+}
+
 /**
  * Test a HART index in hartmask
  * @param i HART index to test
@@ -95,7 +176,8 @@ static inline int sbi_hartmask_test_hartindex(u32 i,
 					      const struct sbi_hartmask *m)
 {
 	if (i < SBI_HARTMASK_MAX_BITS)
-		return __test_bit(i, m->bits);
+		return __test_bit(i, m->bits) &&
+		       __test_bit(BIT_WORD(i), m->summary);
 	return 0;
 }
 
@@ -115,7 +197,8 @@ static inline int sbi_hartmask_test_hartid(u32 h, const struct sbi_hartmask *m)
  */
 static inline void sbi_hartmask_set_all(struct sbi_hartmask *dstp)
 {
-	bitmap_fill(sbi_hartmask_bits(dstp), SBI_HARTMASK_MAX_BITS);
+	bitmap_fill(dstp->bits, SBI_HARTMASK_MAX_BITS);
+	bitmap_fill(dstp->summary, SBI_HARTMASK_WORDS);
 }
 
 /**
@@ -124,7 +207,92 @@ static inline void sbi_hartmask_set_all(struct sbi_hartmask *dstp)
  */
 static inline void sbi_hartmask_clear_all(struct sbi_hartmask *dstp)
 {
-	bitmap_zero(sbi_hartmask_bits(dstp), SBI_HARTMASK_MAX_BITS);
+	bitmap_zero(dstp->summary, SBI_HARTMASK_WORDS);
+}
+
+/**
+ * Atomically take and clear all HART indices of hartmask
+ * @param shared the hartmask updated using the atomic helpers
+ * @param out the hartmask to fill
+ * @returns true if any HART index was taken
+ */
+static inline bool sbi_hartmask_atomic_take(struct sbi_hartmask *shared,
+					    struct sbi_hartmask *out)
+{
+	u32 i, w;
+	bool ret = false;
+	unsigned long sum, bits;
+
+	sbi_hartmask_clear_all(out);
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_WORDS); i++) {
+		if (!__atomic_load_n(&shared->summary[i], __ATOMIC_RELAXED))
+			continue;
+
+		sum = atomic_raw_xchg_ulong(&shared->summary[i], 0);
+		for (; sum; sum &= sum - 1) {
+			w = i * BITS_PER_LONG + sbi_ffs(sum);
+			bits = atomic_raw_xchg_ulong(&shared->bits[w], 0);
+			if (!bits)
+				continue;
+			sbi_hartmask_write_word(w, bits, out);
+			ret = true;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * Get the number of HARTs in a hartmask
+ * @param m the hartmask pointer
+ */
+static inline u32 sbi_hartmask_weight(const struct sbi_hartmask *m)
+{
+	u32 w, ret = 0;
+
+	for (w = 0; w < SBI_HARTMASK_WORDS; w++)
+		ret += sbi_popcount(sbi_hartmask_word(w, m));
+
+	return ret;
+}
+
+/**
+ * Get the first HART index of hartmask starting from a HART index
+ * @param m the hartmask pointer
+ * @param i HART index to start from
+ * @returns the HART index found or SBI_HARTMASK_MAX_BITS if none
+ */
+static inline u32 sbi_hartmask_next_hartindex(const struct sbi_hartmask *m,
+					      u32 i)
+{
+	unsigned long sum, word;
+	u32 s, w, next;
+
+	if (SBI_HARTMASK_MAX_BITS <= i)
+		return SBI_HARTMASK_MAX_BITS;
+
+	w = BIT_WORD(i);
+	word = sbi_hartmask_word(w, m) & BITMAP_FIRST_WORD_MASK(i);
+	if (word)
+		return w * BITS_PER_LONG + sbi_ffs(word);
+
+	/* Only visit words having their summary bit set */
+	next = w + 1;
+	for (s = BIT_WORD(next); s < BITS_TO_LONGS(SBI_HARTMASK_WORDS); s++) {
+		sum = m->summary[s];
+		if (s == BIT_WORD(next))
+			sum &= BITMAP_FIRST_WORD_MASK(next);
+		for (; sum; sum &= sum - 1) {
+			w = s * BITS_PER_LONG + sbi_ffs(sum);
+			if (SBI_HARTMASK_WORDS <= w)
+				return SBI_HARTMASK_MAX_BITS;
+			word = m->bits[w];
+			if (word)
+				return w * BITS_PER_LONG + sbi_ffs(word);
+		}
+	}
+
+	return SBI_HARTMASK_MAX_BITS;
 }
 
 /**
@@ -135,8 +303,13 @@ static inline void sbi_hartmask_clear_all(struct sbi_hartmask *dstp)
 static inline void sbi_hartmask_copy(struct sbi_hartmask *dstp,
 				     const struct sbi_hartmask *srcp)
 {
-	bitmap_copy(sbi_hartmask_bits(dstp), sbi_hartmask_bits(srcp),
-		    SBI_HARTMASK_MAX_BITS);
+	u32 w;
+
+	sbi_hartmask_clear_all(dstp);
+	for (w = 0; w < SBI_HARTMASK_WORDS; w++) {
+		if (__test_bit(w, srcp->summary))
+			sbi_hartmask_write_word(w, srcp->bits[w], dstp);
+	}
 }
 
 /**
@@ -149,8 +322,22 @@ static inline void sbi_hartmask_and(struct sbi_hartmask *dstp,
 				    const struct sbi_hartmask *src1p,
 				    const struct sbi_hartmask *src2p)
 {
-	bitmap_and(sbi_hartmask_bits(dstp), sbi_hartmask_bits(src1p),
-		   sbi_hartmask_bits(src2p), SBI_HARTMASK_MAX_BITS);
+	DECLARE_BITMAP(summary, SBI_HARTMASK_WORDS);
+	unsigned long word;
+	u32 w;
+
+	bitmap_and(summary, src1p->summary, src2p->summary,
+		   SBI_HARTMASK_WORDS);
+	for (w = 0; w < SBI_HARTMASK_WORDS; w++) {
+		if (!__test_bit(w, summary))
+			continue;
+		word = src1p->bits[w] & src2p->bits[w];
+		if (word)
+			dstp->bits[w] = word;
+		else
+			__clear_bit(w, summary);
+	}
+	bitmap_copy(dstp->summary, summary, SBI_HARTMASK_WORDS);
 }
 
 /**
@@ -163,8 +350,17 @@ static inline void sbi_hartmask_or(struct sbi_hartmask *dstp,
 				   const struct sbi_hartmask *src1p,
 				   const struct sbi_hartmask *src2p)
 {
-	bitmap_or(sbi_hartmask_bits(dstp), sbi_hartmask_bits(src1p),
-		  sbi_hartmask_bits(src2p), SBI_HARTMASK_MAX_BITS);
+	DECLARE_BITMAP(summary, SBI_HARTMASK_WORDS);
+	u32 w;
+
+	bitmap_or(summary, src1p->summary, src2p->summary,
+		  SBI_HARTMASK_WORDS);
+	for (w = 0; w < SBI_HARTMASK_WORDS; w++) {
+		if (__test_bit(w, summary))
+			dstp->bits[w] = sbi_hartmask_word(w, src1p) |
+					sbi_hartmask_word(w, src2p);
+	}
+	bitmap_copy(dstp->summary, summary, SBI_HARTMASK_WORDS);
 }
 
 /**
@@ -177,8 +373,17 @@ static inline void sbi_hartmask_xor(struct sbi_hartmask *dstp,
 				    const struct sbi_hartmask *src1p,
 				    const struct sbi_hartmask *src2p)
 {
-	bitmap_xor(sbi_hartmask_bits(dstp), sbi_hartmask_bits(src1p),
-		   sbi_hartmask_bits(src2p), SBI_HARTMASK_MAX_BITS);
+	DECLARE_BITMAP(summary, SBI_HARTMASK_WORDS);
+	u32 w;
+
+	bitmap_or(summary, src1p->summary, src2p->summary,
+		  SBI_HARTMASK_WORDS);
+	for (w = 0; w < SBI_HARTMASK_WORDS; w++) {
+		if (__test_bit(w, summary))
+			dstp->bits[w] = sbi_hartmask_word(w, src1p) ^
+					sbi_hartmask_word(w, src2p);
+	}
+	bitmap_copy(dstp->summary, summary, SBI_HARTMASK_WORDS);
 }
 
 /**
@@ -187,8 +392,8 @@ static inline void sbi_hartmask_xor(struct sbi_hartmask *dstp,
  * __m hartmask
 */
 #define sbi_hartmask_for_each_hartindex(__i, __m) \
-	for((__i) = find_first_bit((__m)->bits, SBI_HARTMASK_MAX_BITS); \
+	for((__i) = sbi_hartmask_next_hartindex((__m), 0); \
 		(__i) < SBI_HARTMASK_MAX_BITS; \
-		(__i) = find_next_bit((__m)->bits, SBI_HARTMASK_MAX_BITS, (__i) + 1))
+		(__i) = sbi_hartmask_next_hartindex((__m), (__i) + 1))
 
 #endif
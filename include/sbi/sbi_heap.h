@@ -21,6 +21,27 @@ extern struct sbi_heap_control global_hpctrl;
 /* Alignment of heap base address and size */
 #define HEAP_BASE_ALIGN			1024
 
+/* Size of one slab serving small allocations */
+#define SBI_HEAP_SLAB_SHIFT		12
+#define SBI_HEAP_SLAB_SIZE		(1UL << SBI_HEAP_SLAB_SHIFT)
+
+/* Power-of-two size classes from 64 B up to SBI_HEAP_SLAB_SIZE */
+#define SBI_HEAP_SLAB_MIN_SHIFT		6
+#define SBI_HEAP_SLAB_CLASSES		\
+	(SBI_HEAP_SLAB_SHIFT - SBI_HEAP_SLAB_MIN_SHIFT + 1)
+
+#ifdef CONFIG_SBI_HEAP_SLAB
+/*
+ * Estimate of the heap lost to slabs, one partially used slab per size
+ * class. This is not a bound as several slabs of a class can be
+ * partially used at once.
+ */
+#define SBI_HEAP_SLAB_HEAP_SIZE		\
+	(SBI_HEAP_SLAB_CLASSES * SBI_HEAP_SLAB_SIZE)
+#else
+#define SBI_HEAP_SLAB_HEAP_SIZE		0
+#endif
+
 struct sbi_scratch;
 
 /** Allocate from heap area */
@@ -36,4 +36,29 @@ void __sbi_hfence_vvma_va(unsigned long va);
 /** Invalidate all possible Stage2 TLBs */
 void __sbi_hfence_vvma_all(void);
 
+/** Order prior stores before subsequent Svinval invalidations */
+void __sbi_sfence_w_inval(void);
+
+/** Order prior Svinval invalidations before subsequent implicit references */
+void __sbi_sfence_inval_ir(void);
+
+/** Svinval: invalidate TLB entries for given asid and virtual address */
+void __sbi_sinval_vma_asid_va(unsigned long va, unsigned long asid);
+
+/** Svinval: invalidate TLB entries for given virtual address */
+void __sbi_sinval_vma_va(unsigned long va);
+
+/** Svinval: invalidate Stage2 TLBs for given VMID and guest physical address */
+void __sbi_hinval_gvma_vmid_gpa(unsigned long gpa_divby_4,
+				unsigned long vmid);
+
+/** Svinval: invalidate Stage2 TLBs for given guest physical address */
+void __sbi_hinval_gvma_gpa(unsigned long gpa_divby_4);
+
+/** Svinval: invalidate unified TLB entries for given asid and guest virtual address */
+void __sbi_hinval_vvma_asid_va(unsigned long va, unsigned long asid);
+
+/** Svinval: invalidate unified TLB entries for a given guest virtual address */
+void __sbi_hinval_vvma_va(unsigned long va);
+
 #endif
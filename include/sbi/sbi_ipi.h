@@ -18,6 +18,8 @@
 
 /* clang-format on */
 
+struct sbi_hartmask;
+
 /** IPI hardware device */
 struct sbi_ipi_device {
 	/** Name of the IPI device */
@@ -28,6 +30,9 @@ struct sbi_ipi_device {
 
 	/** Clear IPI for the current hart */
 	void (*ipi_clear)(void);
+
+	/** Send IPI to a set of target HART indices (optional) */
+	void (*ipi_send_mask)(const struct sbi_hartmask *mask);
 };
 
 enum sbi_ipi_update_type {
@@ -69,6 +74,15 @@ struct sbi_ipi_event_ops {
 	 * remote HART after IPI is triggered.
 	 */
 	void (* process)(struct sbi_scratch *scratch);
+
+	/**
+	 * Allow delivery through cluster leaders to large sets of HARTs
+	 * Note: The update callback of such events may be called by a
+	 * cluster leader HART on behalf of the sender, so it must not
+	 * depend on the current HART, must not wait for other HARTs and
+	 * must never return SBI_IPI_UPDATE_RETRY.
+	 */
+	bool forward;
 };
 
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data);
@@ -85,8 +99,18 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase);
 
 void sbi_ipi_process(void);
 
+bool sbi_ipi_process_events(unsigned long events);
+
+bool sbi_ipi_process_forwards(struct sbi_scratch *scratch);
+
 int sbi_ipi_raw_send(u32 hartindex);
 
+int sbi_ipi_raw_send_mask(const struct sbi_hartmask *mask);
+
+int sbi_ipi_set_hart_cluster(u32 hartindex, u32 cluster);
+
+int sbi_ipi_set_tree_min_harts(u32 min_harts, u32 *old_min_harts);
+
 void sbi_ipi_raw_clear(void);
 
 const struct sbi_ipi_device *sbi_ipi_get_device(void);
@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Lock-free multi-producer single-consumer ring
+ */
+
+#ifndef __SBI_MPSC_H__
+#define __SBI_MPSC_H__
+
+#include <sbi/sbi_fifo.h>
+#include <sbi/sbi_types.h>
+
+/*
+ * Every slot of the ring carries a sequence number in front of its payload.
+ * For slot i of a ring with N entries, the sequence number is:
+ *   pos       => slot is free and may be reserved by the producer of pos
+ *   pos + 1   => slot holds the published entry of pos
+ *   BUSY      => slot is owned by the consumer or by an in-place update
+ * where pos is the absolute (never wrapping) ring position with
+ * pos % N == i.
+ */
+#define SBI_MPSC_SEQ_BUSY		(-1UL)
+
+struct sbi_mpsc {
+	void *queue;
+	unsigned long head;
+	unsigned long tail;
+	u16 entry_size;
+	u16 slot_size;
+	u16 num_entries;
+};
+
+/** Size (in bytes) of one ring slot holding an entry of given size */
+#define SBI_MPSC_SLOT_SIZE(__entry_size)				\
+	((sizeof(unsigned long) + (__entry_size) +			\
+	  __SIZEOF_POINTER__ - 1) & ~(__SIZEOF_POINTER__ - 1))
+
+/** Size (in bytes) of the queue memory required by a ring */
+#define SBI_MPSC_MEM_SIZE(__entries, __entry_size)			\
+	((unsigned long)(__entries) * SBI_MPSC_SLOT_SIZE(__entry_size))
+
+void sbi_mpsc_init(struct sbi_mpsc *ring, void *queue_mem, u16 entries,
+		   u16 entry_size);
+int sbi_mpsc_enqueue(struct sbi_mpsc *ring, void *data);
+int sbi_mpsc_dequeue(struct sbi_mpsc *ring, void *data);
+int sbi_mpsc_is_empty(struct sbi_mpsc *ring);
+u16 sbi_mpsc_avail(struct sbi_mpsc *ring);
+int sbi_mpsc_inplace_update(struct sbi_mpsc *ring, void *in,
+			    int (*fptr)(void *in, void *data));
+
+#endif
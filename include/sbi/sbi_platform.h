@@ -40,12 +40,16 @@
 /** Offset of hart_index2id in struct sbi_platform */
 #define SBI_PLATFORM_HART_INDEX2ID_OFFSET (0x60 + (__SIZEOF_POINTER__ * 2))
 
-#define SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT		(1UL << 12)
+/** TLB range flush limit is calibrated per-hart at boot time */
+#define SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_AUTO		(~0ULL)
+#define SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT	\
+	SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_AUTO
 
 #ifndef __ASSEMBLER__
 
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_heap.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_version.h>
 #include <sbi/sbi_trap_ldst.h>
@@ -144,9 +148,9 @@ struct sbi_platform_operations {
 /** Platform default per-HART stack size for exception/interrupt handling */
 #define SBI_PLATFORM_DEFAULT_HART_STACK_SIZE	8192
 
-/** Platform default heap size */
+/** Platform default heap size, including the small allocation slabs */
 #define SBI_PLATFORM_DEFAULT_HEAP_SIZE(__num_hart)	\
-					(0x8000 + 0x1000 * (__num_hart))
+		(0x8000 + 0x1000 * (__num_hart) + SBI_HEAP_SLAB_HEAP_SIZE)
 
 /** Representation of a platform */
 struct sbi_platform {
@@ -307,8 +311,8 @@ static inline unsigned long sbi_platform_get_features(
  *
  * @param plat pointer to struct sbi_platform
  *
- * @return tlb range flush limit value. Returns a default (page size) if not
- * defined by platform.
+ * @return tlb range flush limit value. Returns a default (calibrated at
+ * boot time for each hart) if not defined by platform.
  */
 static inline u64 sbi_platform_tlbr_flush_limit(const struct sbi_platform *plat)
 {
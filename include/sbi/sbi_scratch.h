@@ -248,6 +248,13 @@ extern struct sbi_scratch *hartindex_to_scratch_table[];
  */
 u32 sbi_hartid_to_hartindex(u32 hartid);
 
+/**
+ * Check whether HART ids are contiguous in HART index order
+ * @param base output HART id of HART index 0
+ * @returns true if HART index i has HART id (base + i) for every HART
+ */
+bool sbi_hartid_is_linear(u32 *base);
+
 /** Get sbi_scratch from HART id */
 #define sbi_hartid_to_scratch(__hartid) \
 	sbi_hartindex_to_scratch(sbi_hartid_to_hartindex(__hartid))
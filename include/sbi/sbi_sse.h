@@ -70,6 +70,11 @@ int sbi_sse_inject_event(uint32_t event_id);
 
 void sbi_sse_process_pending_events(struct sbi_trap_regs *regs);
 
+/* Check if events may have to be injected on return to the current hart
+ * @return true if the hart is unmasked and has enabled events
+ */
+bool sbi_sse_events_enabled(void);
+
 
 int sbi_sse_init(struct sbi_scratch *scratch, bool cold_boot);
 void sbi_sse_exit(struct sbi_scratch *scratch);
@@ -10,6 +10,13 @@
 #ifndef __SBI_TIMER_H__
 #define __SBI_TIMER_H__
 
+#include <sbi/sbi_const.h>
+
+/** Timer MMIO address flag: only 32-bit reads are supported */
+#define SBI_TIMER_MMIO_32BIT		_UL(0x1)
+
+#ifndef __ASSEMBLER__
+
 #include <sbi/sbi_types.h>
 
 /** Timer hardware device */
@@ -23,6 +30,12 @@ struct sbi_timer_device {
 	/** Get free-running timer value */
 	u64 (*timer_value)(void);
 
+	/**
+	 * Get MMIO address of free-running timer of current HART ORed
+	 * with SBI_TIMER_MMIO_xyz flags, or zero if not memory mapped
+	 */
+	unsigned long (*timer_value_mmio)(void);
+
 	/** Start timer event for current HART */
 	void (*timer_event_start)(u64 next_event);
 
@@ -104,4 +117,6 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot);
 /* Exit timer */
 void sbi_timer_exit(struct sbi_scratch *scratch);
 
+#endif /* __ASSEMBLER__ */
+
 #endif
@@ -33,29 +33,86 @@ enum sbi_tlb_type {
 	SBI_TLB_TYPE_MAX,
 };
 
+/*
+ * Maximum number of harts waiting for one (merged) request. Requests are
+ * only merged if the union of their source harts fits.
+ */
+#define SBI_TLB_INFO_MAX_SRC		4
+
+/** Unused source HART index of a request */
+#define SBI_TLB_INFO_NO_SRC		0xffff
+
 struct sbi_tlb_info {
 	unsigned long start;
 	unsigned long size;
 	uint16_t asid;
 	uint16_t vmid;
 	enum sbi_tlb_type type;
-	struct sbi_hartmask smask;
+	/* HART indices of the source harts */
+	uint16_t src[SBI_TLB_INFO_MAX_SRC];
 };
 
 #define SBI_TLB_INFO_INIT(__p, __start, __size, __asid, __vmid, __type, __src) \
 do { \
+	u32 __i; \
 	(__p)->start = (__start); \
 	(__p)->size = (__size); \
 	(__p)->asid = (__asid); \
 	(__p)->vmid = (__vmid); \
 	(__p)->type = (__type); \
-	SBI_HARTMASK_INIT_EXCEPT(&(__p)->smask, (__src)); \
+	(__p)->src[0] = sbi_hartid_to_hartindex(__src); \
+	for (__i = 1; __i < SBI_TLB_INFO_MAX_SRC; __i++) \
+		(__p)->src[__i] = SBI_TLB_INFO_NO_SRC; \
 } while (0)
 
 #define SBI_TLB_INFO_SIZE		sizeof(struct sbi_tlb_info)
 
+/** Phases of remote fences timed by the rfence latency statistics */
+enum sbi_tlb_stat_phase {
+	/** sbi_tlb_request() on the issuing hart (cycles) */
+	SBI_TLB_STAT_TOTAL = 0,
+	/** From sbi_tlb_request() to the target hart picking it up (ticks) */
+	SBI_TLB_STAT_DELIVERY,
+	/** Local fence on the target hart (cycles) */
+	SBI_TLB_STAT_PROCESS,
+	/** Waiting for the target harts on the issuing hart (cycles) */
+	SBI_TLB_STAT_SYNC,
+	SBI_TLB_STAT_PHASE_MAX,
+};
+
+/*
+ * Number of log2 buckets of a latency histogram. Bucket i counts the
+ * latencies in [2^i, 2^(i+1)) and the last bucket also counts all the
+ * larger latencies.
+ */
+#define SBI_TLB_STAT_BUCKETS		20
+
+/** Per-hart rfence latency histograms (layout exposed to S-mode) */
+struct sbi_tlb_stats {
+	u32 hist[SBI_TLB_STAT_PHASE_MAX][SBI_TLB_TYPE_MAX][SBI_TLB_STAT_BUCKETS];
+};
+
+#ifdef CONFIG_SBI_TLB_STATS
+#define SBI_TLB_STATS_HEAP_SIZE		(sizeof(struct sbi_tlb_stats) + 64)
+#else
+#define SBI_TLB_STATS_HEAP_SIZE		0
+#endif
+
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo);
 
+void sbi_tlb_process_pending(struct sbi_scratch *scratch);
+
+int sbi_tlb_residency_enable(void);
+
+int sbi_tlb_residency_hint(unsigned long asid, unsigned long vmid);
+
+const struct sbi_tlb_stats *sbi_tlb_stats_get(u32 hartindex);
+
+void sbi_tlb_stats_reset(u32 hartindex);
+
+void sbi_tlb_get_flush_limits_str(struct sbi_scratch *scratch,
+				  char *limits_str, int nlimits_str);
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot);
 
 #endif
@@ -266,6 +266,46 @@ static inline void sbi_trap_set_context(struct sbi_scratch *scratch,
 
 struct sbi_trap_context *sbi_trap_handler(struct sbi_trap_context *tcntx);
 
+/** Number of exception causes and local interrupts with a handler slot */
+#define SBI_TRAP_CAUSE_MAX		64
+
+typedef int (*sbi_trap_exception_handler_t)(struct sbi_trap_context *tcntx);
+typedef int (*sbi_trap_irq_handler_t)(void);
+
+int sbi_trap_set_exception_handler(unsigned long cause,
+				   sbi_trap_exception_handler_t handler);
+
+int sbi_trap_set_irq_handler(unsigned long irq, sbi_trap_irq_handler_t handler);
+
+int sbi_trap_init(struct sbi_scratch *scratch, bool cold_boot);
+
+/** Trap trace record (layout exposed to S-mode) */
+struct sbi_trap_trace_entry {
+	/* MCAUSE of the trap */
+	unsigned long cause;
+	/* A7 and A6 on ecall entry, zero for other traps */
+	unsigned long extid;
+	unsigned long funcid;
+	/* MCYCLE on trap handler entry and exit */
+	u64 entry_cycle;
+	u64 exit_cycle;
+};
+
+#ifdef CONFIG_SBI_TRAP_TRACE
+#define SBI_TRAP_TRACE_HEAP_SIZE	\
+	(CONFIG_SBI_TRAP_TRACE_ENTRIES * sizeof(struct sbi_trap_trace_entry) + 64)
+#else
+#define SBI_TRAP_TRACE_HEAP_SIZE	0
+#endif
+
+/** Consume the trace records read instead of taking a snapshot */
+#define SBI_TRAP_TRACE_READ_DRAIN	(1UL << 0)
+
+int sbi_trap_trace_read(struct sbi_trap_trace_entry *out,
+			unsigned long num_entries, unsigned long flags);
+
+int sbi_trap_trace_init(struct sbi_scratch *scratch, bool cold_boot);
+
 #endif
 
 #endif
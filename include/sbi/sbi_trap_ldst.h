@@ -20,6 +20,35 @@ union sbi_ldst_data {
 	ulong data_ulong;
 };
 
+/** Decoded load or store instruction */
+struct sbi_ldst_decode {
+	/* Access (or vector element) length in bytes, zero if not decoded */
+	u8 len;
+	/* Instruction length in bytes */
+	u8 insn_len;
+	/* Shift applied for sign extension of loaded values */
+	u8 shift;
+	/* Floating point register is accessed */
+	u8 fp;
+	/* Index of the destination (load) or source (store) register */
+	u8 reg;
+	/* Vector unit-stride access */
+	u8 vector;
+	/* Vector access is masked by v0 */
+	u8 masked;
+	/* Index of the base address register of a vector access */
+	u8 base;
+};
+
+ulong sbi_misaligned_tinst_fixup(ulong orig_tinst, ulong new_tinst,
+				 ulong addr_offset);
+
+int sbi_misaligned_v_ld_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx);
+
+int sbi_misaligned_v_st_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx);
+
 int sbi_misaligned_load_handler(struct sbi_trap_context *tcntx);
 
 int sbi_misaligned_store_handler(struct sbi_trap_context *tcntx);
@@ -30,4 +59,8 @@ int sbi_store_access_handler(struct sbi_trap_context *tcntx);
 
 int sbi_double_trap_handler(struct sbi_trap_context *tcntx);
 
+void sbi_trap_ldst_cache_flush(void);
+
+int sbi_trap_ldst_init(struct sbi_scratch *scratch, bool cold_boot);
+
 #endif
@@ -36,6 +36,18 @@ DECLARE_UNPRIVILEGED_LOAD_FUNCTION(u64)
 DECLARE_UNPRIVILEGED_STORE_FUNCTION(u64)
 DECLARE_UNPRIVILEGED_LOAD_FUNCTION(ulong)
 
+/**
+ * Copy bytes from or to a misaligned unprivileged address using as few
+ * MPRV accesses as possible.
+ *
+ * @return number of bytes copied, less than len on a fault with the fault
+ * described by trap
+ */
+ulong sbi_load_misaligned(const void *addr, void *data, ulong len,
+			  struct sbi_trap_info *trap);
+ulong sbi_store_misaligned(void *addr, const void *data, ulong len,
+			   struct sbi_trap_info *trap);
+
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap);
 
 #endif
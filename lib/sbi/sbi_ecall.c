@@ -7,10 +7,17 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_domain.h>
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_sse.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 
 extern struct sbi_ecall_extension *sbi_ecall_exts[];
@@ -40,7 +47,29 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
-struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+#define ECALL_TABLE_MAX		32
+
+/*
+ * Registered extension ID ranges sorted by start so that lookups on the
+ * trap path are a binary search over one array instead of a list walk.
+ * Single extension IDs are ranges with start equal to end. The table is
+ * built once all extensions are registered and rebuilt if registration
+ * changes later on. Lookups fall back to the list while the table is not
+ * valid, when there are too many ranges or when table lookups are turned
+ * off at runtime for comparison.
+ */
+struct ecall_table_entry {
+	unsigned long extid_start;
+	unsigned long extid_end;
+	struct sbi_ecall_extension *ext;
+};
+
+static struct ecall_table_entry ecall_table[ECALL_TABLE_MAX];
+static unsigned long ecall_table_count;
+static bool ecall_table_valid;
+static u32 ecall_table_lookup = 1;
+
+static struct sbi_ecall_extension *ecall_list_find(unsigned long extid)
 {
 	struct sbi_ecall_extension *t, *ret = NULL;
 
@@ -54,6 +83,62 @@ struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
 	return ret;
 }
 
+static void ecall_table_build(void)
+{
+	struct sbi_ecall_extension *t;
+	unsigned long i, count = 0;
+
+	ecall_table_valid = false;
+
+	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
+		if (count == ECALL_TABLE_MAX)
+			return;
+
+		/* Insertion sort, ranges never overlap */
+		for (i = count; i; i--) {
+			if (ecall_table[i - 1].extid_start < t->extid_start)
+				break;
+			ecall_table[i] = ecall_table[i - 1];
+		}
+		ecall_table[i].extid_start = t->extid_start;
+		ecall_table[i].extid_end = t->extid_end;
+		ecall_table[i].ext = t;
+		count++;
+	}
+
+	ecall_table_count = count;
+	ecall_table_valid = true;
+}
+
+struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+{
+	unsigned long lo = 0, hi = ecall_table_count, mid;
+
+	if (!ecall_table_valid ||
+	    !__atomic_load_n(&ecall_table_lookup, __ATOMIC_RELAXED))
+		return ecall_list_find(extid);
+
+	/* Find the last range starting at or below extid */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (extid < ecall_table[mid].extid_start)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	if (lo && extid <= ecall_table[lo - 1].extid_end)
+		return ecall_table[lo - 1].ext;
+
+	return NULL;
+}
+
+void sbi_ecall_set_table_lookup(u32 enable, u32 *old_enable)
+{
+	*old_enable = __atomic_exchange_n(&ecall_table_lookup, enable ? 1 : 0,
+					  __ATOMIC_RELAXED);
+}
+
 int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 {
 	struct sbi_ecall_extension *t;
@@ -73,6 +158,9 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 	SBI_INIT_LIST_HEAD(&ext->head);
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
 
+	if (ecall_table_valid)
+		ecall_table_build();
+
 	return 0;
 }
 
@@ -91,8 +179,11 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		if (ecall_table_valid)
+			ecall_table_build();
+	}
 }
 
 int sbi_ecall_handler(struct sbi_trap_context *tcntx)
@@ -142,12 +233,190 @@ int sbi_ecall_handler(struct sbi_trap_context *tcntx)
 	return 0;
 }
 
+/*
+ * Leaf handler of the set_timer calls recognized by the trap entry fast
+ * path. Only the caller saved registers of the interrupted context are
+ * saved at this point so a non-zero return sends the ecall through the
+ * full trap handler instead, for example when SSE events may have to be
+ * injected on the way back.
+ */
+int sbi_ecall_fast_set_timer(unsigned long next_lo, unsigned long next_hi)
+{
+	if (sbi_sse_events_enabled())
+		return SBI_ENOTSUPP;
+
+#if __riscv_xlen == 32
+	sbi_timer_event_start(((u64)next_hi << 32) | (u64)next_lo);
+#else
+	sbi_timer_event_start((u64)next_lo);
+#endif
+
+	return 0;
+}
+
+/* Per-hart batch ring registered by S-mode, num_entries is zero if none */
+struct ecall_batch_state {
+	unsigned long base;
+	unsigned long num_entries;
+};
+
+static unsigned long ecall_batch_off;
+
+int sbi_ecall_batch_register(unsigned long phys_lo, unsigned long phys_hi,
+			     unsigned long num_entries)
+{
+	ulong smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >>
+			MSTATUS_MPP_SHIFT;
+	struct ecall_batch_state *bs;
+	unsigned long size;
+
+	if (!ecall_batch_off)
+		return SBI_ENOTSUPP;
+
+	bs = sbi_scratch_thishart_offset_ptr(ecall_batch_off);
+
+	/* An all ones address disables the ring */
+	if (phys_lo == -1UL && phys_hi == -1UL) {
+		bs->num_entries = 0;
+		bs->base = 0;
+		return 0;
+	}
+
+	/* Same as DBCN, only the lower XLEN bits of the address are used */
+	if (phys_hi)
+		return SBI_EINVALID_ADDR;
+
+	if (!num_entries || SBI_ECALL_BATCH_MAX_ENTRIES < num_entries ||
+	    (phys_lo & (sizeof(unsigned long) - 1)))
+		return SBI_EINVAL;
+
+	/* The ring is checked once here and trusted on every submit */
+	size = sizeof(struct sbi_ecall_batch_ring) +
+	       num_entries * sizeof(struct sbi_ecall_batch_entry);
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					 phys_lo, size, smode,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	bs->base = phys_lo;
+	bs->num_entries = num_entries;
+
+	return 0;
+}
+
+/*
+ * Calls which may not return, which rewrite the trap context or which
+ * would nest batches are not allowed in a batch.
+ */
+static bool ecall_batch_allowed(unsigned long extid)
+{
+	switch (extid) {
+	case SBI_EXT_HSM:
+	case SBI_EXT_SRST:
+	case SBI_EXT_SUSP:
+	case SBI_EXT_SSE:
+	case SBI_EXT_OPENSBI:
+		return false;
+	default:
+		return SBI_EXT_0_1_SHUTDOWN < extid;
+	}
+}
+
+static void ecall_batch_run(const struct sbi_trap_regs *trap_regs,
+			    struct sbi_ecall_batch_entry *entry)
+{
+	struct sbi_ecall_return out = {0};
+	struct sbi_ecall_extension *ext;
+	struct sbi_trap_regs regs;
+	int ret = SBI_ENOTSUPP;
+
+	/* Handlers see the batch entry as if it was the trapped ecall */
+	sbi_memcpy(&regs, trap_regs, sizeof(regs));
+	regs.a0 = entry->args[0];
+	regs.a1 = entry->args[1];
+	regs.a2 = entry->args[2];
+	regs.a3 = entry->args[3];
+	regs.a4 = entry->args[4];
+	regs.a5 = entry->args[5];
+	regs.a6 = entry->funcid;
+	regs.a7 = entry->extid;
+
+	ext = sbi_ecall_find_extension(entry->extid);
+	if (ext && ext->handle && ecall_batch_allowed(entry->extid))
+		ret = ext->handle(entry->extid, entry->funcid, &regs, &out);
+
+	if (ret < SBI_LAST_ERR || SBI_SUCCESS < ret)
+		ret = SBI_ERR_FAILED;
+
+	entry->error = ret;
+	entry->value = out.value;
+}
+
+int sbi_ecall_batch_submit(const struct sbi_trap_regs *regs,
+			   struct sbi_ecall_return *out)
+{
+	struct sbi_ecall_batch_entry entry, *slot;
+	struct sbi_ecall_batch_ring *ring;
+	struct ecall_batch_state *bs;
+	unsigned long start, head, tail;
+
+	if (!ecall_batch_off)
+		return SBI_ENOTSUPP;
+
+	bs = sbi_scratch_thishart_offset_ptr(ecall_batch_off);
+	if (!bs->num_entries)
+		return SBI_ENO_SHMEM;
+
+	ring = (struct sbi_ecall_batch_ring *)bs->base;
+	sbi_hart_map_saddr((unsigned long)ring, sizeof(*ring));
+	head = ring->head;
+	tail = ring->tail;
+	sbi_hart_unmap_saddr();
+
+	if (bs->num_entries < tail - head)
+		return SBI_EINVAL;
+
+	/*
+	 * Entries are copied in and out so that the shared memory is not
+	 * mapped while the handlers run, they may map other memory.
+	 */
+	for (start = head; head != tail; head++) {
+		slot = &ring->entries[head % bs->num_entries];
+
+		sbi_hart_map_saddr((unsigned long)slot, sizeof(*slot));
+		sbi_memcpy(&entry, slot, sizeof(entry));
+		sbi_hart_unmap_saddr();
+
+		ecall_batch_run(regs, &entry);
+
+		sbi_hart_map_saddr((unsigned long)slot, sizeof(*slot));
+		slot->error = entry.error;
+		slot->value = entry.value;
+		sbi_hart_unmap_saddr();
+	}
+
+	sbi_hart_map_saddr((unsigned long)ring, sizeof(*ring));
+	ring->head = head;
+	sbi_hart_unmap_saddr();
+
+	out->value = head - start;
+
+	return 0;
+}
+
 int sbi_ecall_init(void)
 {
 	int ret;
 	struct sbi_ecall_extension *ext;
 	unsigned long i;
 
+#ifdef CONFIG_SBI_ECALL_BATCH
+	ecall_batch_off = sbi_scratch_alloc_offset(
+					sizeof(struct ecall_batch_state));
+	if (!ecall_batch_off)
+		return SBI_ENOMEM;
+#endif
+
 	for (i = 0; i < sbi_ecall_exts_size; i++) {
 		ext = sbi_ecall_exts[i];
 		ret = SBI_ENODEV;
@@ -158,5 +427,7 @@ int sbi_ecall_init(void)
 			return ret;
 	}
 
+	ecall_table_build();
+
 	return 0;
 }
@@ -0,0 +1,188 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * OpenSBI firmware specific extension
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_tlb.h>
+#include <sbi/sbi_trap.h>
+
+/* Firmware specific extensions are identified by the implementation ID */
+_Static_assert(SBI_EXT_OPENSBI == (SBI_EXT_FIRMWARE_START | SBI_OPENSBI_IMPID),
+	       "SBI_EXT_OPENSBI does not match SBI_OPENSBI_IMPID");
+
+static int sbi_ecall_opensbi_stats_hartindex(unsigned long hartid,
+					     u32 *hartindex)
+{
+	*hartindex = sbi_hartid_to_hartindex(hartid);
+	if (!sbi_hartindex_valid(*hartindex) ||
+	    !sbi_domain_is_assigned_hart(sbi_domain_thishart_ptr(), *hartindex))
+		return SBI_EINVAL;
+
+	return 0;
+}
+
+static int sbi_ecall_opensbi_stats_read(struct sbi_trap_regs *regs,
+					struct sbi_ecall_return *out)
+{
+	ulong smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >>
+			MSTATUS_MPP_SHIFT;
+	const struct sbi_tlb_stats *stats;
+	unsigned long size;
+	u32 hartindex;
+	int ret;
+
+	ret = sbi_ecall_opensbi_stats_hartindex(regs->a0, &hartindex);
+	if (ret)
+		return ret;
+
+	stats = sbi_tlb_stats_get(hartindex);
+	if (!stats)
+		return SBI_ENOTSUPP;
+
+	/* Same as DBCN, only the lower XLEN bits of the address are used */
+	if (regs->a3)
+		return SBI_ERR_FAILED;
+
+	size = regs->a1;
+	if (size > sizeof(*stats))
+		size = sizeof(*stats);
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					 regs->a2, size, smode,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_ERR_INVALID_PARAM;
+
+	sbi_hart_map_saddr(regs->a2, size);
+	sbi_memcpy((void *)regs->a2, stats, size);
+	sbi_hart_unmap_saddr();
+
+	out->value = size;
+	return 0;
+}
+
+static int sbi_ecall_opensbi_trace_read(struct sbi_trap_regs *regs,
+					struct sbi_ecall_return *out)
+{
+	ulong smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >>
+			MSTATUS_MPP_SHIFT;
+	unsigned long num_entries;
+	int ret;
+
+	/* Reading nothing tells whether tracing is available */
+	ret = sbi_trap_trace_read(NULL, 0, 0);
+	if (ret < 0)
+		return ret;
+
+	/* Same as DBCN, only the lower XLEN bits of the address are used */
+	if (regs->a2)
+		return SBI_ERR_FAILED;
+
+	num_entries = regs->a0 / sizeof(struct sbi_trap_trace_entry);
+	if (!num_entries)
+		return 0;
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(), regs->a1,
+				num_entries * sizeof(struct sbi_trap_trace_entry),
+				smode, SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_ERR_INVALID_PARAM;
+
+	sbi_hart_map_saddr(regs->a1,
+			   num_entries * sizeof(struct sbi_trap_trace_entry));
+	ret = sbi_trap_trace_read((struct sbi_trap_trace_entry *)regs->a1,
+				  num_entries, regs->a3);
+	sbi_hart_unmap_saddr();
+	if (ret < 0)
+		return ret;
+
+	out->value = ret * sizeof(struct sbi_trap_trace_entry);
+	return 0;
+}
+
+static int sbi_ecall_opensbi_tunable_set(struct sbi_trap_regs *regs,
+					 struct sbi_ecall_return *out)
+{
+	u32 old_value;
+	int ret;
+
+	/* Tunables affect every domain so only the root domain may set them */
+	if (sbi_domain_thishart_ptr() != &root)
+		return SBI_EDENIED;
+
+	if (regs->a1 != (u32)regs->a1)
+		return SBI_EINVAL;
+
+	switch (regs->a0) {
+	case SBI_OPENSBI_TUNABLE_IPI_TREE_MIN_HARTS:
+		ret = sbi_ipi_set_tree_min_harts(regs->a1, &old_value);
+		break;
+	case SBI_OPENSBI_TUNABLE_ECALL_TABLE:
+		sbi_ecall_set_table_lookup(regs->a1, &old_value);
+		ret = 0;
+		break;
+	default:
+		return SBI_EINVAL;
+	}
+	if (ret)
+		return ret;
+
+	out->value = old_value;
+	return 0;
+}
+
+static int sbi_ecall_opensbi_handler(unsigned long extid, unsigned long funcid,
+				     struct sbi_trap_regs *regs,
+				     struct sbi_ecall_return *out)
+{
+	u32 hartindex;
+	int ret;
+
+	switch (funcid) {
+	case SBI_EXT_OPENSBI_TLB_RESIDENCY_ENABLE:
+		return sbi_tlb_residency_enable();
+	case SBI_EXT_OPENSBI_TLB_RESIDENCY_HINT:
+		return sbi_tlb_residency_hint(regs->a0, regs->a1);
+	case SBI_EXT_OPENSBI_RFENCE_STATS_READ:
+		return sbi_ecall_opensbi_stats_read(regs, out);
+	case SBI_EXT_OPENSBI_RFENCE_STATS_RESET:
+		ret = sbi_ecall_opensbi_stats_hartindex(regs->a0, &hartindex);
+		if (ret)
+			return ret;
+		if (!sbi_tlb_stats_get(hartindex))
+			return SBI_ENOTSUPP;
+		sbi_tlb_stats_reset(hartindex);
+		return 0;
+	case SBI_EXT_OPENSBI_BATCH_REGISTER:
+		return sbi_ecall_batch_register(regs->a0, regs->a1, regs->a2);
+	case SBI_EXT_OPENSBI_BATCH_SUBMIT:
+		return sbi_ecall_batch_submit(regs, out);
+	case SBI_EXT_OPENSBI_TRAP_TRACE_READ:
+		return sbi_ecall_opensbi_trace_read(regs, out);
+	case SBI_EXT_OPENSBI_TUNABLE_SET:
+		return sbi_ecall_opensbi_tunable_set(regs, out);
+	default:
+		break;
+	}
+
+	return SBI_ENOTSUPP;
+}
+
+struct sbi_ecall_extension ecall_opensbi;
+
+static int sbi_ecall_opensbi_register_extensions(void)
+{
+	return sbi_ecall_register_extension(&ecall_opensbi);
+}
+
+struct sbi_ecall_extension ecall_opensbi = {
+	.extid_start		= SBI_EXT_OPENSBI,
+	.extid_end		= SBI_EXT_OPENSBI,
+	.register_extensions	= sbi_ecall_opensbi_register_extensions,
+	.handle			= sbi_ecall_opensbi_handler,
+};
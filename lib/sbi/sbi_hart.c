@@ -688,6 +688,8 @@ const struct sbi_hart_ext_data sbi_hart_ext[] = {
 	__SBI_HART_EXT_DATA(zicfilp, SBI_HART_EXT_ZICFILP),
 	__SBI_HART_EXT_DATA(zicfiss, SBI_HART_EXT_ZICFISS),
 	__SBI_HART_EXT_DATA(ssdbltrp, SBI_HART_EXT_SSDBLTRP),
+	__SBI_HART_EXT_DATA(svinval, SBI_HART_EXT_SVINVAL),
+	__SBI_HART_EXT_DATA(zawrs, SBI_HART_EXT_ZAWRS),
 };
 
 _Static_assert(SBI_HART_EXT_MAX == array_size(sbi_hart_ext),
@@ -1013,6 +1015,10 @@ int sbi_hart_init(struct sbi_scratch *scratch, bool cold_boot)
 	if (rc)
 		return rc;
 
+	rc = sbi_trap_init(scratch, cold_boot);
+	if (rc)
+		return rc;
+
 	return sbi_hart_reinit(scratch);
 }
 
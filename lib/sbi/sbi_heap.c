@@ -8,6 +8,7 @@
  */
 
 #include <sbi/riscv_locks.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_list.h>
@@ -18,10 +19,63 @@
 #define HEAP_ALLOC_ALIGN		64
 #define HEAP_HOUSEKEEPING_FACTOR	16
 
+#ifdef CONFIG_SBI_HEAP_SLAB
+#define HEAP_SLAB	true
+#else
+#define HEAP_SLAB	false
+#endif
+
+/*
+ * Power-of-two size classes from HEAP_ALLOC_ALIGN up to HEAP_SLAB_SIZE
+ * are served from slabs. A slab is one naturally aligned chunk of
+ * HEAP_SLAB_SIZE bytes taken from the first-fit allocator.
+ */
+#define HEAP_SLAB_MIN_SHIFT		SBI_HEAP_SLAB_MIN_SHIFT
+#define HEAP_SLAB_CLASSES		SBI_HEAP_SLAB_CLASSES
+#define HEAP_SLAB_NONE			0xff
+
+#ifdef CONFIG_SBI_HEAP_MAGAZINE
+#define HEAP_MAGAZINE	true
+#else
+#define HEAP_MAGAZINE	false
+#endif
+
+/*
+ * Per-hart magazines of the global heap cache free objects of the size
+ * classes from 64 B to 1 KiB. They are refilled from and drained to the
+ * slabs HEAP_MAG_BATCH objects at a time. The lock of a magazine is only
+ * contended when another hart fails to allocate and drains all of them.
+ */
+#define HEAP_MAG_CLASSES		5
+#define HEAP_MAG_SIZE			6
+#define HEAP_MAG_BATCH			(HEAP_MAG_SIZE / 2)
+
+/*
+ * Heap nodes live in the housekeeping area so that no metadata is stored
+ * in heap blocks. Used and free nodes are indexed by address in two AA
+ * trees, free nodes are also kept on a list in address order.
+ */
 struct heap_node {
 	struct sbi_dlist head;
 	unsigned long addr;
 	unsigned long size;
+	struct heap_node *left;
+	struct heap_node *right;
+	unsigned long level;
+};
+
+/*
+ * Slab descriptor, one per HEAP_SLAB_SIZE chunk of the heap area and
+ * kept in the housekeeping area. Free objects are chained through
+ * their first word and objects never handed out so far are carved
+ * from the end of the slab.
+ */
+struct heap_slab {
+	struct sbi_dlist head;
+	void *free;
+	u16 inuse;
+	u16 carved;
+	u8 class;
 };
 
 struct sbi_heap_control {
@@ -32,11 +86,140 @@ struct sbi_heap_control {
 	unsigned long hksize;
 	struct sbi_dlist free_node_list;
 	struct sbi_dlist free_space_list;
-	struct sbi_dlist used_space_list;
+	struct heap_node *free_root;
+	struct heap_node *used_root;
+	spinlock_t slab_lock;
+	struct heap_slab *slab_map;
+	unsigned long slab_first;
+	unsigned long slab_count;
+	unsigned long slab_free;
+	struct sbi_dlist slab_partial[HEAP_SLAB_CLASSES];
+};
+
+struct heap_magazine {
+	spinlock_t lock;
+	u8 count[HEAP_MAG_CLASSES];
+	void *objs[HEAP_MAG_CLASSES][HEAP_MAG_SIZE];
 };
 
 struct sbi_heap_control global_hpctrl;
 
+static unsigned long heap_mag_off;
+
+static inline unsigned long node_level(struct heap_node *t)
+{
+	return t ? t->level : 0;
+}
+
+static struct heap_node *node_skew(struct heap_node *t)
+{
+	struct heap_node *l = t ? t->left : NULL;
+
+	if (!l || l->level != t->level)
+		return t;
+
+	t->left = l->right;
+	l->right = t;
+	return l;
+}
+
+static struct heap_node *node_split(struct heap_node *t)
+{
+	struct heap_node *r = t ? t->right : NULL;
+
+	if (!r || !r->right || r->right->level != t->level)
+		return t;
+
+	t->right = r->left;
+	r->left = t;
+	r->level++;
+	return r;
+}
+
+static struct heap_node *node_insert(struct heap_node *t,
+				     struct heap_node *n)
+{
+	if (!t) {
+		n->left = n->right = NULL;
+		n->level = 1;
+		return n;
+	}
+
+	if (n->addr < t->addr)
+		t->left = node_insert(t->left, n);
+	else
+		t->right = node_insert(t->right, n);
+
+	return node_split(node_skew(t));
+}
+
+static struct heap_node *node_remove(struct heap_node *t,
+				     struct heap_node *n)
+{
+	struct heap_node *r;
+	unsigned long level;
+
+	if (!t)
+		return NULL;
+
+	if (n->addr < t->addr) {
+		t->left = node_remove(t->left, n);
+	} else if (t->addr < n->addr) {
+		t->right = node_remove(t->right, n);
+	} else {
+		if (!t->left && !t->right)
+			return NULL;
+
+		/* Move the in-order neighbour of the node into its place */
+		if (!t->left) {
+			for (r = t->right; r->left; r = r->left)
+				;
+			t->right = node_remove(t->right, r);
+		} else {
+			for (r = t->left; r->right; r = r->right)
+				;
+			t->left = node_remove(t->left, r);
+		}
+		r->left = t->left;
+		r->right = t->right;
+		r->level = t->level;
+		t = r;
+	}
+
+	level = MIN(node_level(t->left), node_level(t->right)) + 1;
+	if (level < t->level) {
+		t->level = level;
+		if (level < node_level(t->right))
+			t->right->level = level;
+	}
+
+	t = node_skew(t);
+	t->right = node_skew(t->right);
+	if (t->right)
+		t->right->right = node_skew(t->right->right);
+	t = node_split(t);
+	t->right = node_split(t->right);
+
+	return t;
+}
+
+/* Node with the highest address not above addr */
+static struct heap_node *node_floor(struct heap_node *t, unsigned long addr)
+{
+	struct heap_node *ret = NULL;
+
+	while (t) {
+		if (t->addr <= addr) {
+			ret = t;
+			t = t->right;
+		} else {
+			t = t->left;
+		}
+	}
+
+	return ret;
+}
+
 static void *alloc_with_align(struct sbi_heap_control *hpctrl,
 			      size_t align, size_t size)
 {
@@ -82,8 +265,8 @@ static void *alloc_with_align(struct sbi_heap_control *hpctrl,
 			sbi_list_del(&rem->head);
 			rem->addr = np->addr + (size + pad);
 			rem->size = np->size - (size + pad);
-			sbi_list_add_tail(&rem->head,
-					  &hpctrl->free_space_list);
+			sbi_list_add(&rem->head, &np->head);
+			hpctrl->free_root = node_insert(hpctrl->free_root, rem);
 		} else if (size + pad != np->size) {
 			/* Can't allocate, return n */
 			sbi_list_add(&n->head, &hpctrl->free_node_list);
@@ -93,7 +276,7 @@ static void *alloc_with_align(struct sbi_heap_control *hpctrl,
 
 		n->addr = lowest_aligned;
 		n->size = size;
-		sbi_list_add_tail(&n->head, &hpctrl->used_space_list);
+		hpctrl->used_root = node_insert(hpctrl->used_root, n);
 
 		np->size = pad;
 		ret = (void *)n->addr;
@@ -105,13 +288,15 @@ static void *alloc_with_align(struct sbi_heap_control *hpctrl,
 			sbi_list_del(&n->head);
 			n->addr = np->addr;
 			n->size = size;
+			hpctrl->used_root = node_insert(hpctrl->used_root, n);
+			/* Address order is kept since nothing is in between */
 			np->addr += size;
 			np->size -= size;
-			sbi_list_add_tail(&n->head, &hpctrl->used_space_list);
 			ret = (void *)n->addr;
 		} else if (size == np->size) {
 			sbi_list_del(&np->head);
-			sbi_list_add_tail(&np->head, &hpctrl->used_space_list);
+			hpctrl->free_root = node_remove(hpctrl->free_root, np);
+			hpctrl->used_root = node_insert(hpctrl->used_root, np);
 			ret = (void *)np->addr;
 		}
 	}
@@ -122,9 +307,323 @@ out:
 	return ret;
 }
 
+static inline unsigned long slab_obj_size(unsigned int class)
+{
+	return 1UL << (class + HEAP_SLAB_MIN_SHIFT);
+}
+
+static inline unsigned long slab_addr(struct sbi_heap_control *hpctrl,
+				      struct heap_slab *s)
+{
+	return (hpctrl->slab_first + (s - hpctrl->slab_map)) <<
+		SBI_HEAP_SLAB_SHIFT;
+}
+
+static struct heap_slab *slab_lookup(struct sbi_heap_control *hpctrl,
+				     unsigned long addr)
+{
+	if (!hpctrl->slab_map || addr < hpctrl->base ||
+	    (hpctrl->base + hpctrl->size) <= addr)
+		return NULL;
+
+	return &hpctrl->slab_map[(addr >> SBI_HEAP_SLAB_SHIFT) -
+				 hpctrl->slab_first];
+}
+
+/* Hand chunks of released slabs back to the first-fit allocator */
+static void slab_release(struct sbi_heap_control *hpctrl,
+			 struct sbi_dlist *release)
+{
+	struct heap_slab *s, *sn;
+
+	/* Chunks are still allocated so nobody else can reuse the slabs */
+	sbi_list_for_each_entry_safe(s, sn, release, head) {
+		sbi_list_del(&s->head);
+		sbi_free_from(hpctrl, (void *)slab_addr(hpctrl, s));
+	}
+}
+
+/* Give empty slabs back to the first-fit allocator */
+static void slab_reclaim(struct sbi_heap_control *hpctrl)
+{
+	struct heap_slab *s, *sn;
+	SBI_LIST_HEAD(release);
+	unsigned int c;
+
+	spin_lock(&hpctrl->slab_lock);
+	for (c = 0; c < HEAP_SLAB_CLASSES; c++) {
+		sbi_list_for_each_entry_safe(s, sn, &hpctrl->slab_partial[c],
+					     head) {
+			if (s->inuse)
+				continue;
+			sbi_list_del(&s->head);
+			s->class = HEAP_SLAB_NONE;
+			hpctrl->slab_free -= SBI_HEAP_SLAB_SIZE;
+			sbi_list_add_tail(&s->head, &release);
+		}
+	}
+	spin_unlock(&hpctrl->slab_lock);
+
+	slab_release(hpctrl, &release);
+}
+
+static void heap_mag_drain(struct sbi_heap_control *hpctrl);
+
+/* First-fit allocation, retried once cached objects have been given back */
+static void *heap_alloc(struct sbi_heap_control *hpctrl,
+			size_t align, size_t size)
+{
+	void *ret = alloc_with_align(hpctrl, align, size);
+
+	if (!ret && HEAP_SLAB && hpctrl->slab_map && size) {
+		heap_mag_drain(hpctrl);
+		slab_reclaim(hpctrl);
+		ret = alloc_with_align(hpctrl, align, size);
+	}
+
+	return ret;
+}
+
+static inline unsigned int slab_class(size_t size)
+{
+	return (size <= HEAP_ALLOC_ALIGN) ? 0 :
+		sbi_fls(size - 1) + 1 - HEAP_SLAB_MIN_SHIFT;
+}
+
+/*
+ * Take up to count objects of a size class under one acquisition of the
+ * slab lock. A new slab is only carved when no object is available.
+ */
+static unsigned long slab_alloc_bulk(struct sbi_heap_control *hpctrl,
+				     unsigned int class, void **objs,
+				     unsigned long count)
+{
+	struct sbi_dlist *partial = &hpctrl->slab_partial[class];
+	unsigned long done = 0;
+	struct heap_slab *s;
+	void *chunk, *obj;
+
+	spin_lock(&hpctrl->slab_lock);
+
+	while (done < count) {
+		if (sbi_list_empty(partial)) {
+			if (done)
+				break;
+			spin_unlock(&hpctrl->slab_lock);
+
+			chunk = heap_alloc(hpctrl, SBI_HEAP_SLAB_SIZE,
+					   SBI_HEAP_SLAB_SIZE);
+			if (!chunk)
+				return 0;
+
+			s = slab_lookup(hpctrl, (unsigned long)chunk);
+			spin_lock(&hpctrl->slab_lock);
+			s->free = NULL;
+			s->inuse = 0;
+			s->carved = 0;
+			s->class = class;
+			sbi_list_add(&s->head, partial);
+			hpctrl->slab_free += SBI_HEAP_SLAB_SIZE;
+		}
+
+		s = sbi_list_first_entry(partial, struct heap_slab, head);
+		if (s->free) {
+			obj = s->free;
+			s->free = *(void **)obj;
+		} else {
+			obj = (void *)(slab_addr(hpctrl, s) +
+				       s->carved * slab_obj_size(class));
+			s->carved++;
+		}
+		s->inuse++;
+		hpctrl->slab_free -= slab_obj_size(class);
+		if (s->inuse ==
+		    (SBI_HEAP_SLAB_SIZE >> (class + HEAP_SLAB_MIN_SHIFT)))
+			sbi_list_del(&s->head);
+		objs[done++] = obj;
+	}
+
+	spin_unlock(&hpctrl->slab_lock);
+
+	return done;
+}
+
+/* Put an object back into its slab, called with the slab lock held */
+static void slab_put(struct sbi_heap_control *hpctrl, struct heap_slab *s,
+		     void *ptr, struct sbi_dlist *release)
+{
+	struct sbi_dlist *partial = &hpctrl->slab_partial[s->class];
+	u16 total = SBI_HEAP_SLAB_SIZE >> (s->class + HEAP_SLAB_MIN_SHIFT);
+
+	*(void **)ptr = s->free;
+	s->free = ptr;
+	if (s->inuse-- == total)
+		sbi_list_add(&s->head, partial);
+	hpctrl->slab_free += slab_obj_size(s->class);
+
+	/* Keep one empty slab per class to absorb alloc/free pairs */
+	if (!s->inuse && (partial->next != &s->head ||
+			  partial->prev != &s->head)) {
+		sbi_list_del(&s->head);
+		s->class = HEAP_SLAB_NONE;
+		hpctrl->slab_free -= SBI_HEAP_SLAB_SIZE;
+		sbi_list_add_tail(&s->head, release);
+	}
+}
+
+static void slab_free_bulk(struct sbi_heap_control *hpctrl, void **objs,
+			   unsigned long count)
+{
+	SBI_LIST_HEAD(release);
+	unsigned long i;
+
+	spin_lock(&hpctrl->slab_lock);
+	for (i = 0; i < count; i++)
+		slab_put(hpctrl, slab_lookup(hpctrl, (unsigned long)objs[i]),
+			 objs[i], &release);
+	spin_unlock(&hpctrl->slab_lock);
+
+	slab_release(hpctrl, &release);
+}
+
+static bool slab_free(struct sbi_heap_control *hpctrl, void *ptr)
+{
+	struct heap_slab *s = slab_lookup(hpctrl, (unsigned long)ptr);
+	SBI_LIST_HEAD(release);
+
+	if (!s)
+		return false;
+
+	spin_lock(&hpctrl->slab_lock);
+
+	if (s->class == HEAP_SLAB_NONE) {
+		spin_unlock(&hpctrl->slab_lock);
+		return false;
+	}
+	slab_put(hpctrl, s, ptr, &release);
+
+	spin_unlock(&hpctrl->slab_lock);
+
+	slab_release(hpctrl, &release);
+
+	return true;
+}
+
+static struct heap_magazine *heap_mag_ptr(struct sbi_heap_control *hpctrl)
+{
+	if (!HEAP_MAGAZINE || hpctrl != &global_hpctrl || !heap_mag_off)
+		return NULL;
+
+	return sbi_scratch_thishart_offset_ptr(heap_mag_off);
+}
+
+/* Give the objects cached by all harts back to their slabs */
+static void heap_mag_drain(struct sbi_heap_control *hpctrl)
+{
+	struct sbi_scratch *scratch;
+	struct heap_magazine *mag;
+	unsigned int c;
+	u32 i;
+
+	if (!heap_mag_ptr(hpctrl))
+		return;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++) {
+		scratch = sbi_hartindex_to_scratch(i);
+		if (!scratch)
+			continue;
+		mag = sbi_scratch_offset_ptr(scratch, heap_mag_off);
+		spin_lock(&mag->lock);
+		for (c = 0; c < HEAP_MAG_CLASSES; c++) {
+			slab_free_bulk(hpctrl, mag->objs[c], mag->count[c]);
+			mag->count[c] = 0;
+		}
+		spin_unlock(&mag->lock);
+	}
+}
+
+static void *heap_mag_alloc(struct sbi_heap_control *hpctrl,
+			    struct heap_magazine *mag, unsigned int class)
+{
+	void *ret = NULL;
+
+	spin_lock(&mag->lock);
+	if (!mag->count[class])
+		mag->count[class] = slab_alloc_bulk(hpctrl, class,
+						    mag->objs[class],
+						    HEAP_MAG_BATCH);
+	if (mag->count[class])
+		ret = mag->objs[class][--mag->count[class]];
+	spin_unlock(&mag->lock);
+
+	return ret;
+}
+
+static void heap_mag_free(struct sbi_heap_control *hpctrl,
+			  struct heap_magazine *mag, unsigned int class,
+			  void *ptr)
+{
+	void **objs = mag->objs[class];
+
+	spin_lock(&mag->lock);
+
+	/* Drain the least recently freed objects when full */
+	if (mag->count[class] == HEAP_MAG_SIZE) {
+		slab_free_bulk(hpctrl, objs, HEAP_MAG_BATCH);
+		sbi_memmove(objs, &objs[HEAP_MAG_BATCH],
+			    (HEAP_MAG_SIZE - HEAP_MAG_BATCH) * sizeof(*objs));
+		mag->count[class] -= HEAP_MAG_BATCH;
+	}
+
+	objs[mag->count[class]++] = ptr;
+
+	spin_unlock(&mag->lock);
+}
+
+/* Bytes of objects cached by all harts, only exact while harts are idle */
+static unsigned long heap_mag_free_space(struct sbi_heap_control *hpctrl)
+{
+	struct sbi_scratch *scratch;
+	struct heap_magazine *mag;
+	unsigned long ret = 0;
+	unsigned int c;
+	u32 i;
+
+	if (!heap_mag_ptr(hpctrl))
+		return 0;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++) {
+		scratch = sbi_hartindex_to_scratch(i);
+		if (!scratch)
+			continue;
+		mag = sbi_scratch_offset_ptr(scratch, heap_mag_off);
+		for (c = 0; c < HEAP_MAG_CLASSES; c++)
+			ret += mag->count[c] * slab_obj_size(c);
+	}
+
+	return ret;
+}
+
 void *sbi_malloc_from(struct sbi_heap_control *hpctrl, size_t size)
 {
-	return alloc_with_align(hpctrl, HEAP_ALLOC_ALIGN, size);
+	struct heap_magazine *mag;
+	unsigned int class;
+	void *ret;
+
+	if (HEAP_SLAB && hpctrl->slab_map && size &&
+	    size <= SBI_HEAP_SLAB_SIZE) {
+		class = slab_class(size);
+		mag = heap_mag_ptr(hpctrl);
+		if (mag && class < HEAP_MAG_CLASSES) {
+			ret = heap_mag_alloc(hpctrl, mag, class);
+			if (ret)
+				return ret;
+		} else if (slab_alloc_bulk(hpctrl, class, &ret, 1)) {
+			return ret;
+		}
+	}
+
+	return heap_alloc(hpctrl, HEAP_ALLOC_ALIGN, size);
 }
 
 void *sbi_aligned_alloc_from(struct sbi_heap_control *hpctrl,
@@ -141,7 +640,7 @@ void *sbi_aligned_alloc_from(struct sbi_heap_control *hpctrl,
 	if (size % alignment != 0)
 		return NULL;
 
-	return alloc_with_align(hpctrl, alignment, size);
+	return heap_alloc(hpctrl, alignment, size);
 }
 
 void *sbi_zalloc_from(struct sbi_heap_control *hpctrl, size_t size)
@@ -155,48 +654,63 @@ void *sbi_zalloc_from(struct sbi_heap_control *hpctrl, size_t size)
 
 void sbi_free_from(struct sbi_heap_control *hpctrl, void *ptr)
 {
-	struct heap_node *n, *np;
+	struct heap_node *np, *prev, *next;
+	bool merge_prev, merge_next;
+	struct heap_magazine *mag;
+	struct heap_slab *s;
 
 	if (!ptr)
 		return;
 
-	spin_lock(&hpctrl->lock);
-
-	np = NULL;
-	sbi_list_for_each_entry(n, &hpctrl->used_space_list, head) {
-		if ((n->addr <= (unsigned long)ptr) &&
-		    ((unsigned long)ptr < (n->addr + n->size))) {
-			np = n;
-			break;
+	if (HEAP_SLAB) {
+		/* Class of a live object can not change under us */
+		mag = heap_mag_ptr(hpctrl);
+		s = slab_lookup(hpctrl, (unsigned long)ptr);
+		if (mag && s && s->class < HEAP_MAG_CLASSES) {
+			heap_mag_free(hpctrl, mag, s->class, ptr);
+			return;
 		}
+		if (slab_free(hpctrl, ptr))
+			return;
 	}
-	if (!np) {
+
+	spin_lock(&hpctrl->lock);
+
+	np = node_floor(hpctrl->used_root, (unsigned long)ptr);
+	if (!np || (np->addr + np->size) <= (unsigned long)ptr) {
 		spin_unlock(&hpctrl->lock);
 		return;
 	}
-
-	sbi_list_del(&np->head);
-
-	sbi_list_for_each_entry(n, &hpctrl->free_space_list, head) {
-		if ((np->addr + np->size) == n->addr) {
-			n->addr = np->addr;
-			n->size += np->size;
-			sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
-			np = NULL;
-			break;
-		} else if (np->addr == (n->addr + n->size)) {
-			n->size += np->size;
-			sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
-			np = NULL;
-			break;
-		} else if ((n->addr + n->size) < np->addr) {
-			sbi_list_add(&np->head, &n->head);
-			np = NULL;
-			break;
+	hpctrl->used_root = node_remove(hpctrl->used_root, np);
+
+	/* Free neighbours are the free nodes around np in address order */
+	prev = node_floor(hpctrl->free_root, np->addr);
+	next = sbi_list_entry(prev ? prev->head.next :
+			      hpctrl->free_space_list.next,
+			      struct heap_node, head);
+	merge_prev = prev && (prev->addr + prev->size) == np->addr;
+	merge_next = &next->head != &hpctrl->free_space_list &&
+		     (np->addr + np->size) == next->addr;
+
+	if (merge_prev) {
+		prev->size += np->size;
+		sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
+		if (merge_next) {
+			prev->size += next->size;
+			sbi_list_del(&next->head);
+			hpctrl->free_root = node_remove(hpctrl->free_root, next);
+			sbi_list_add_tail(&next->head, &hpctrl->free_node_list);
 		}
+	} else if (merge_next) {
+		/* Address order is kept since nothing is in between */
+		next->addr = np->addr;
+		next->size += np->size;
+		sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
+	} else {
+		sbi_list_add(&np->head, prev ? &prev->head :
+				       &hpctrl->free_space_list);
+		hpctrl->free_root = node_insert(hpctrl->free_root, np);
 	}
-	if (np)
-		sbi_list_add_tail(&np->head, &hpctrl->free_space_list);
 
 	spin_unlock(&hpctrl->lock);
 }
@@ -211,12 +725,18 @@ unsigned long sbi_heap_free_space_from(struct sbi_heap_control *hpctrl)
 		ret += n->size;
 	spin_unlock(&hpctrl->lock);
 
-	return ret;
+	/* Unused objects of slabs are free as well */
+	spin_lock(&hpctrl->slab_lock);
+	ret += hpctrl->slab_free;
+	spin_unlock(&hpctrl->slab_lock);
+
+	return ret + heap_mag_free_space(hpctrl);
 }
 
 unsigned long sbi_heap_used_space_from(struct sbi_heap_control *hpctrl)
 {
-	return hpctrl->size - hpctrl->hksize - sbi_heap_free_space();
+	return hpctrl->size - hpctrl->hksize -
+	       sbi_heap_free_space_from(hpctrl);
 }
 
 unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
@@ -227,7 +747,7 @@ unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
 int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 		       unsigned long size)
 {
-	unsigned long i;
+	unsigned long i, nodes_base;
 	struct heap_node *n;
 
 	/* Initialize heap control */
@@ -239,11 +759,32 @@ int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 	hpctrl->hksize &= ~((unsigned long)HEAP_BASE_ALIGN - 1);
 	SBI_INIT_LIST_HEAD(&hpctrl->free_node_list);
 	SBI_INIT_LIST_HEAD(&hpctrl->free_space_list);
-	SBI_INIT_LIST_HEAD(&hpctrl->used_space_list);
+	hpctrl->free_root = NULL;
+	hpctrl->used_root = NULL;
+
+	/* Place slab descriptors in front of the heap nodes */
+	SPIN_LOCK_INIT(hpctrl->slab_lock);
+	hpctrl->slab_map = NULL;
+	hpctrl->slab_first = hpctrl->base >> SBI_HEAP_SLAB_SHIFT;
+	hpctrl->slab_count = ((hpctrl->base + hpctrl->size - 1) >>
+			      SBI_HEAP_SLAB_SHIFT) - hpctrl->slab_first + 1;
+	hpctrl->slab_free = 0;
+	for (i = 0; i < HEAP_SLAB_CLASSES; i++)
+		SBI_INIT_LIST_HEAD(&hpctrl->slab_partial[i]);
+	nodes_base = hpctrl->hkbase;
+	if (HEAP_SLAB &&
+	    hpctrl->slab_count * sizeof(struct heap_slab) <= hpctrl->hksize / 2) {
+		hpctrl->slab_map = (struct heap_slab *)hpctrl->hkbase;
+		for (i = 0; i < hpctrl->slab_count; i++)
+			hpctrl->slab_map[i].class = HEAP_SLAB_NONE;
+		nodes_base += ROUNDUP(hpctrl->slab_count *
+				      sizeof(struct heap_slab), sizeof(*n));
+	}
 
 	/* Prepare free node list */
-	for (i = 0; i < (hpctrl->hksize / sizeof(*n)); i++) {
-		n = (struct heap_node *)(hpctrl->hkbase + (sizeof(*n) * i));
+	for (i = 0; i < ((hpctrl->hkbase + hpctrl->hksize - nodes_base) /
+			 sizeof(*n)); i++) {
+		n = (struct heap_node *)(nodes_base + (sizeof(*n) * i));
 		SBI_INIT_LIST_HEAD(&n->head);
 		n->addr = n->size = 0;
 		sbi_list_add_tail(&n->head, &hpctrl->free_node_list);
@@ -256,12 +797,15 @@ int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 	n->addr = hpctrl->hkbase + hpctrl->hksize;
 	n->size = hpctrl->size - hpctrl->hksize;
 	sbi_list_add_tail(&n->head, &hpctrl->free_space_list);
+	hpctrl->free_root = node_insert(hpctrl->free_root, n);
 
 	return 0;
 }
 
 int sbi_heap_init(struct sbi_scratch *scratch)
 {
+	int rc;
+
 	/* Sanity checks on heap offset and size */
 	if (!scratch->fw_heap_size ||
 	    (scratch->fw_heap_size & (HEAP_BASE_ALIGN - 1)) ||
@@ -270,9 +814,19 @@ int sbi_heap_init(struct sbi_scratch *scratch)
 	    (scratch->fw_heap_offset & (HEAP_BASE_ALIGN - 1)))
 		return SBI_EINVAL;
 
-	return sbi_heap_init_new(&global_hpctrl,
-				  scratch->fw_start + scratch->fw_heap_offset,
-				  scratch->fw_heap_size);
+	rc = sbi_heap_init_new(&global_hpctrl,
+			       scratch->fw_start + scratch->fw_heap_offset,
+			       scratch->fw_heap_size);
+	if (rc)
+		return rc;
+
+	if (HEAP_MAGAZINE && global_hpctrl.slab_map) {
+		heap_mag_off = sbi_scratch_alloc_type_offset(struct heap_magazine);
+		if (!heap_mag_off)
+			return SBI_ENOMEM;
+	}
+
+	return 0;
 }
 
 int sbi_heap_alloc_new(struct sbi_heap_control **hpctrl)
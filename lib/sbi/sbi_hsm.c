@@ -32,12 +32,21 @@
 	if (state != (oldstate))					\
 		sbi_printf("%s: ERR: The hart is in invalid state [%lu]\n", \
 			   __func__, state);				\
+	else								\
+		hsm_interruptible_update((hdata)->hartindex, newstate);	\
 	state == (oldstate);						\
 })
 
 static const struct sbi_hsm_device *hsm_dev = NULL;
 static unsigned long hart_data_offset;
 
+/*
+ * HART indices of all harts in a state which can take IPIs. This is kept
+ * up to date on every HSM state change so that IPI senders don't need to
+ * read the state of every hart.
+ */
+static struct sbi_hartmask hsm_interruptible_harts;
+
 /** Per hart specific data to manage state transition **/
 struct sbi_hsm_data {
 	atomic_t state;
@@ -50,8 +59,26 @@ struct sbi_hsm_data {
 	unsigned long saved_menvcfgh;
 #endif
 	atomic_t start_ticket;
+	u32 hartindex;
 };
 
+static inline bool hsm_state_interruptible(long state)
+{
+	return state == SBI_HSM_STATE_STARTED ||
+	       state == SBI_HSM_STATE_SUSPENDED ||
+	       state == SBI_HSM_STATE_RESUME_PENDING;
+}
+
+static void hsm_interruptible_update(u32 hartindex, long state)
+{
+	if (hsm_state_interruptible(state))
+		sbi_hartmask_atomic_set_hartindex(hartindex,
+						  &hsm_interruptible_harts);
+	else
+		sbi_hartmask_atomic_clear_hartindex(hartindex,
+						    &hsm_interruptible_harts);
+}
+
 bool sbi_hsm_hart_change_state(struct sbi_scratch *scratch, long oldstate,
 			       long newstate)
 {
@@ -118,20 +145,13 @@ static void hsm_start_ticket_release(struct sbi_hsm_data *hdata)
 int sbi_hsm_hart_interruptible_mask(const struct sbi_domain *dom,
 				    struct sbi_hartmask *mask)
 {
-	int hstate, ret;
-	u32 i;
+	int ret;
 
 	ret = sbi_domain_get_assigned_hartmask(dom, mask);
 	if (ret)
 		return ret;
 
-	sbi_hartmask_for_each_hartindex(i, mask) {
-		hstate = __sbi_hsm_hart_get_state(i);
-		if (hstate != SBI_HSM_STATE_STARTED &&
-		    hstate != SBI_HSM_STATE_SUSPENDED &&
-		    hstate != SBI_HSM_STATE_RESUME_PENDING)
-			sbi_hartmask_clear_hartindex(i, mask);
-	}
+	sbi_hartmask_and(mask, mask, &hsm_interruptible_harts);
 
 	return 0;
 }
@@ -260,6 +280,7 @@ int sbi_hsm_init(struct sbi_scratch *scratch, bool cold_boot)
 				    SBI_HSM_STATE_START_PENDING :
 				    SBI_HSM_STATE_STOPPED);
 			ATOMIC_INIT(&hdata->start_ticket, 0);
+			hdata->hartindex = i;
 		}
 	} else {
 		sbi_hsm_hart_wait(scratch);
@@ -188,6 +188,8 @@ static void sbi_boot_print_hart(struct sbi_scratch *scratch, u32 hartid)
 		   sbi_hart_mhpm_mask(scratch));
 	sbi_printf("Boot HART Debug Triggers  : %d triggers\n",
 		   sbi_dbtr_get_total_triggers());
+	sbi_tlb_get_flush_limits_str(scratch, str, sizeof(str));
+	sbi_printf("Boot HART TLB Flush Limit : %s pages\n", str);
 	sbi_hart_delegation_dump(scratch, "Boot HART ", "         ");
 }
 
@@ -261,6 +263,13 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_trap_trace_init(scratch, true);
+	if (rc) {
+		sbi_printf("%s: trap trace init failed (error %d)\n",
+			   __func__, rc);
+		sbi_hart_hang();
+	}
+
 	rc = sbi_sse_init(scratch, true);
 	if (rc) {
 		sbi_printf("%s: sse init failed (error %d)\n", __func__, rc);
@@ -398,6 +407,10 @@ static void __noreturn init_warm_startup(struct sbi_scratch *scratch,
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_trap_trace_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_sse_init(scratch, false);
 	if (rc)
 		sbi_hart_hang();
@@ -36,8 +36,43 @@ static unsigned long ipi_data_off;
 static const struct sbi_ipi_device *ipi_dev = NULL;
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
 
+#ifdef CONFIG_SBI_IPI_TREE_MIN_HARTS
+#define IPI_TREE_MIN_HARTS	CONFIG_SBI_IPI_TREE_MIN_HARTS
+#else
+#define IPI_TREE_MIN_HARTS	0
+#endif
+
+/*
+ * Forward descriptor published by a sender in its own scratch space for
+ * hierarchical delivery. Cluster leaders get the sender set in their
+ * forward pending hartmask, deliver the event to the targets of their
+ * cluster and then decrement the pending count.
+ */
+struct sbi_ipi_fwd {
+	u32 event;
+	void *data;
+	atomic_t pending;
+	struct sbi_hartmask targets;
+};
+
+static unsigned long ipi_fwd_off;
+static unsigned long ipi_fwd_pending_off;
+static u32 ipi_fwd_event = SBI_IPI_EVENT_MAX;
+
+/* Runtime tree delivery threshold, zero for direct delivery */
+static u32 ipi_tree_min_harts = IPI_TREE_MIN_HARTS;
+
+/*
+ * Cluster (plus one) of each HART index, zero if unknown. The HART
+ * indices of cluster c are all within [first[c], end[c]).
+ */
+static u16 ipi_hart_cluster[SBI_HARTMASK_MAX_BITS];
+static u16 ipi_cluster_first[SBI_HARTMASK_MAX_BITS + 1];
+static u16 ipi_cluster_end[SBI_HARTMASK_MAX_BITS + 1];
+static u32 ipi_cluster_max;
+
 static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
-			u32 event, void *data)
+			u32 event, void *data, struct sbi_hartmask *kick_mask)
 {
 	int ret = 0;
 	struct sbi_scratch *remote_scratch = NULL;
@@ -76,11 +111,17 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
 	 *
 	 * Multiple harts may be trying to send IPI to the
 	 * remote hart so call sbi_ipi_raw_send() only when
-	 * the ipi_type was previously zero.
+	 * the ipi_type was previously zero. If the caller
+	 * provided a kick mask, the interrupt is triggered
+	 * later for all remote harts at once.
 	 */
 	if (!__atomic_fetch_or(&ipi_data->ipi_type,
-				BIT(event), __ATOMIC_RELAXED))
-		ret = sbi_ipi_raw_send(remote_hartindex);
+				BIT(event), __ATOMIC_RELAXED)) {
+		if (kick_mask)
+			sbi_hartmask_set_hartindex(remote_hartindex, kick_mask);
+		else
+			ret = sbi_ipi_raw_send(remote_hartindex);
+	}
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
 
@@ -102,6 +143,241 @@ static int sbi_ipi_sync(struct sbi_scratch *scratch, u32 event)
 	return 0;
 }
 
+/*
+ * Convert a (hmask, hbase) pair into a hartmask. When HART ids are
+ * contiguous in HART index order, hmask is shifted into place a word at
+ * a time. Otherwise only the set bits of hmask are looked up.
+ */
+static void sbi_ipi_hmask_to_hartmask(ulong hmask, ulong hbase,
+				      struct sbi_hartmask *mask)
+{
+	ulong off, hartid;
+	u32 base;
+
+	sbi_hartmask_clear_all(mask);
+
+	if (sbi_hartid_is_linear(&base)) {
+		if (hbase < base) {
+			if (base - hbase >= BITS_PER_LONG)
+				return;
+			hmask >>= base - hbase;
+			hbase = base;
+		}
+
+		off = hbase - base;
+		if (off >= SBI_HARTMASK_MAX_BITS)
+			return;
+
+		sbi_hartmask_write_word(BIT_WORD(off),
+					hmask << BIT_WORD_OFFSET(off), mask);
+		if (BIT_WORD_OFFSET(off))
+			sbi_hartmask_write_word(BIT_WORD(off) + 1,
+				hmask >> (BITS_PER_LONG - BIT_WORD_OFFSET(off)),
+				mask);
+		return;
+	}
+
+	for (; hmask; hmask &= hmask - 1) {
+		hartid = hbase + sbi_ffs(hmask);
+		if (hartid >= -1U)
+			break;
+		sbi_hartmask_set_hartid(hartid, mask);
+	}
+}
+
+/*
+ * Send an IPI event to all harts of a target mask on behalf of the hart
+ * owning scratch. The target mask is consumed.
+ */
+static int sbi_ipi_send_targets(struct sbi_scratch *scratch,
+				struct sbi_hartmask *target_mask,
+				u32 event, void *data)
+{
+	int rc;
+	bool retry_needed;
+	u32 i;
+	struct sbi_hartmask kick_mask, *kick = NULL;
+
+	/*
+	 * With a multicast capable IPI device, the update callbacks of
+	 * all remote harts are called first and then all interrupts are
+	 * triggered in one pass.
+	 */
+	if (ipi_dev && ipi_dev->ipi_send_mask)
+		kick = &kick_mask;
+
+	do {
+		rc = 0;
+		retry_needed = false;
+		if (kick)
+			sbi_hartmask_clear_all(kick);
+		sbi_hartmask_for_each_hartindex(i, target_mask) {
+			rc = sbi_ipi_send(scratch, i, event, data, kick);
+			if (rc < 0)
+				break;
+			if (rc == SBI_IPI_UPDATE_RETRY)
+				retry_needed = true;
+			else
+				sbi_hartmask_clear_hartindex(i, target_mask);
+			rc = 0;
+		}
+		/* Kick harts updated so far, even on failure */
+		if (kick)
+			sbi_ipi_raw_send_mask(kick);
+	} while (!rc && retry_needed);
+
+	return rc;
+}
+
+static bool sbi_ipi_tree_wanted(u32 event, const struct sbi_hartmask *mask)
+{
+	u32 min_harts = __atomic_load_n(&ipi_tree_min_harts, __ATOMIC_RELAXED);
+
+	if (!min_harts || !ipi_fwd_off || ipi_cluster_max < 2)
+		return false;
+
+	if (SBI_IPI_EVENT_MAX <= event || !ipi_ops_array[event] ||
+	    !ipi_ops_array[event]->forward)
+		return false;
+
+	return sbi_hartmask_weight(mask) >= min_harts;
+}
+
+int sbi_ipi_set_tree_min_harts(u32 min_harts, u32 *old_min_harts)
+{
+	/* Forward state only exists when built with tree delivery */
+	if (!ipi_fwd_off)
+		return SBI_ENOTSUPP;
+
+	*old_min_harts = __atomic_exchange_n(&ipi_tree_min_harts, min_harts,
+					     __ATOMIC_RELAXED);
+	return 0;
+}
+
+/*
+ * Move the targets of every other cluster, except one leader per
+ * cluster, from the target mask to the forward descriptor of the
+ * current hart and ask the leaders to deliver the event to them.
+ * Targets without a cluster and the own cluster are left to the caller.
+ */
+static struct sbi_ipi_fwd *sbi_ipi_send_tree(struct sbi_scratch *scratch,
+					     struct sbi_hartmask *target_mask,
+					     u32 event, void *data)
+{
+	u32 c, i, leader, own = ipi_hart_cluster[scratch->hartindex];
+	struct sbi_ipi_fwd *fwd = sbi_scratch_offset_ptr(scratch, ipi_fwd_off);
+	struct sbi_hartmask leaders, *rpending;
+	struct sbi_scratch *rscratch;
+
+	fwd->event = event;
+	fwd->data = data;
+	sbi_hartmask_clear_all(&fwd->targets);
+	sbi_hartmask_clear_all(&leaders);
+
+	for (c = 1; c <= ipi_cluster_max; c++) {
+		if (c == own)
+			continue;
+
+		leader = -1U;
+		for (i = sbi_hartmask_next_hartindex(target_mask,
+						     ipi_cluster_first[c]);
+		     i < ipi_cluster_end[c];
+		     i = sbi_hartmask_next_hartindex(target_mask, i + 1)) {
+			if (ipi_hart_cluster[i] != c)
+				continue;
+			if (leader == -1U) {
+				leader = i;
+				continue;
+			}
+			sbi_hartmask_clear_hartindex(i, target_mask);
+			sbi_hartmask_set_hartindex(i, &fwd->targets);
+			sbi_hartmask_set_hartindex(leader, &leaders);
+		}
+	}
+
+	/* Publish the forwarded targets before the leaders see us */
+	ATOMIC_INIT(&fwd->pending, sbi_hartmask_weight(&leaders));
+	smp_wmb();
+
+	sbi_hartmask_for_each_hartindex(i, &leaders) {
+		rscratch = sbi_hartindex_to_scratch(i);
+		rpending = sbi_scratch_offset_ptr(rscratch, ipi_fwd_pending_off);
+		sbi_hartmask_atomic_set_hartindex(scratch->hartindex, rpending);
+		if (sbi_ipi_send(scratch, i, ipi_fwd_event, NULL, NULL) < 0)
+			atomic_sub_return(&fwd->pending, 1);
+	}
+
+	return fwd;
+}
+
+/*
+ * Deliver the events forwarded to the current hart as cluster leader to
+ * the other targets of its cluster. Returns true if there were any.
+ */
+bool sbi_ipi_process_forwards(struct sbi_scratch *scratch)
+{
+	u32 s, i, c = ipi_hart_cluster[scratch->hartindex];
+	struct sbi_hartmask senders, members;
+	struct sbi_hartmask *pending;
+	struct sbi_scratch *sscratch;
+	struct sbi_ipi_fwd *sfwd;
+
+	if (!ipi_fwd_pending_off)
+		return false;
+
+	pending = sbi_scratch_offset_ptr(scratch, ipi_fwd_pending_off);
+	if (!sbi_hartmask_atomic_take(pending, &senders))
+		return false;
+
+	sbi_hartmask_for_each_hartindex(s, &senders) {
+		sscratch = sbi_hartindex_to_scratch(s);
+		if (!sscratch)
+			continue;
+
+		sfwd = sbi_scratch_offset_ptr(sscratch, ipi_fwd_off);
+		sbi_hartmask_clear_all(&members);
+		for (i = sbi_hartmask_next_hartindex(&sfwd->targets,
+						     ipi_cluster_first[c]);
+		     i < ipi_cluster_end[c];
+		     i = sbi_hartmask_next_hartindex(&sfwd->targets, i + 1)) {
+			if (ipi_hart_cluster[i] == c)
+				sbi_hartmask_set_hartindex(i, &members);
+		}
+
+		sbi_ipi_send_targets(sscratch, &members, sfwd->event,
+				     sfwd->data);
+		atomic_sub_return(&sfwd->pending, 1);
+	}
+
+	return true;
+}
+
+static void sbi_ipi_process_fwd(struct sbi_scratch *scratch)
+{
+	sbi_ipi_process_forwards(scratch);
+}
+
+/*
+ * Wait for the leaders to finish forwarding. Forwarding requests and
+ * remote fences from other harts are served meanwhile, because a leader
+ * may itself be a sender waiting for the current hart to complete its
+ * request.
+ */
+static void sbi_ipi_fwd_wait(struct sbi_scratch *scratch,
+			     struct sbi_ipi_fwd *fwd)
+{
+	while (atomic_read(&fwd->pending)) {
+		sbi_ipi_process_forwards(scratch);
+		sbi_tlb_process_pending(scratch);
+		cpu_relax();
+	}
+}
+
+static struct sbi_ipi_event_ops ipi_fwd_ops = {
+	.name = "IPI_FWD",
+	.process = sbi_ipi_process_fwd,
+};
+
 /**
  * As this this function only handlers scalar values of hart mask, it must be
  * set to all online harts if the intention is to send IPIs to all the harts.
@@ -110,9 +386,8 @@ static int sbi_ipi_sync(struct sbi_scratch *scratch, u32 event)
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 {
 	int rc = 0;
-	bool retry_needed;
-	ulong i;
 	struct sbi_hartmask target_mask;
+	struct sbi_ipi_fwd *fwd = NULL;
 	struct sbi_domain *dom = sbi_domain_thishart_ptr();
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
@@ -122,32 +397,22 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 		return rc;
 
 	if (hbase != -1UL) {
-		struct sbi_hartmask tmp_mask = { 0 };
-
-		for (i = hbase; hmask; i++, hmask >>= 1) {
-			if (hmask & 1UL)
-				sbi_hartmask_set_hartid(i, &tmp_mask);
-		}
+		struct sbi_hartmask tmp_mask;
 
+		sbi_ipi_hmask_to_hartmask(hmask, hbase, &tmp_mask);
 		sbi_hartmask_and(&target_mask, &target_mask, &tmp_mask);
 	}
 
+	/* Let cluster leaders deliver to the rest of their cluster */
+	if (sbi_ipi_tree_wanted(event, &target_mask))
+		fwd = sbi_ipi_send_tree(scratch, &target_mask, event, data);
+
 	/* Send IPIs */
-	do {
-		retry_needed = false;
-		sbi_hartmask_for_each_hartindex(i, &target_mask) {
-			rc = sbi_ipi_send(scratch, i, event, data);
-			if (rc < 0)
-				goto done;
-			if (rc == SBI_IPI_UPDATE_RETRY)
-				retry_needed = true;
-			else
-				sbi_hartmask_clear_hartindex(i, &target_mask);
-			rc = 0;
-		}
-	} while (retry_needed);
+	rc = sbi_ipi_send_targets(scratch, &target_mask, event, data);
+
+	if (fwd)
+		sbi_ipi_fwd_wait(scratch, fwd);
 
-done:
 	/* Sync IPIs */
 	sbi_ipi_sync(scratch, event);
 
@@ -188,6 +453,7 @@ static void sbi_ipi_process_smode(struct sbi_scratch *scratch)
 static struct sbi_ipi_event_ops ipi_smode_ops = {
 	.name = "IPI_SMODE",
 	.process = sbi_ipi_process_smode,
+	.forward = true,
 };
 
 static u32 ipi_smode_event = SBI_IPI_EVENT_MAX;
@@ -229,19 +495,12 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase)
 	return sbi_ipi_send_many(hmask, hbase, ipi_halt_event, NULL);
 }
 
-void sbi_ipi_process(void)
+static void sbi_ipi_process_type(struct sbi_scratch *scratch,
+				 unsigned long ipi_type)
 {
-	unsigned long ipi_type;
 	unsigned int ipi_event;
 	const struct sbi_ipi_event_ops *ipi_ops;
-	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
-	struct sbi_ipi_data *ipi_data =
-			sbi_scratch_offset_ptr(scratch, ipi_data_off);
 
-	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_RECVD);
-	sbi_ipi_raw_clear();
-
-	ipi_type = atomic_raw_xchg_ulong(&ipi_data->ipi_type, 0);
 	ipi_event = 0;
 	while (ipi_type) {
 		if (ipi_type & 1UL) {
@@ -254,6 +513,54 @@ void sbi_ipi_process(void)
 	}
 }
 
+void sbi_ipi_process(void)
+{
+	unsigned long ipi_type;
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct sbi_ipi_data *ipi_data =
+			sbi_scratch_offset_ptr(scratch, ipi_data_off);
+
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_RECVD);
+	sbi_ipi_raw_clear();
+
+	ipi_type = atomic_raw_xchg_ulong(&ipi_data->ipi_type, 0);
+	sbi_ipi_process_type(scratch, ipi_type);
+}
+
+/*
+ * Process only the given events pending on the current hart, for callers
+ * which can not run arbitrary event handlers (such as a hart waiting in
+ * the middle of an ecall). Forward requests are always served as they
+ * only send IPIs on behalf of other harts. The other pending events are
+ * left in place and the IPI is raised again so that sbi_ipi_process()
+ * handles them later. Returns true if such events were left pending.
+ */
+bool sbi_ipi_process_events(unsigned long events)
+{
+	unsigned long ipi_type;
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct sbi_ipi_data *ipi_data =
+			sbi_scratch_offset_ptr(scratch, ipi_data_off);
+
+	if (ipi_fwd_event < SBI_IPI_EVENT_MAX)
+		events |= BIT(ipi_fwd_event);
+
+	sbi_ipi_raw_clear();
+
+	ipi_type = __atomic_fetch_and(&ipi_data->ipi_type, ~events,
+				      __ATOMIC_ACQ_REL);
+	if (ipi_type & events) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_RECVD);
+		sbi_ipi_process_type(scratch, ipi_type & events);
+	}
+
+	if (!(ipi_type & ~events))
+		return false;
+
+	sbi_ipi_raw_send(scratch->hartindex);
+	return true;
+}
+
 int sbi_ipi_raw_send(u32 hartindex)
 {
 	if (!ipi_dev || !ipi_dev->ipi_send)
@@ -274,6 +581,44 @@ int sbi_ipi_raw_send(u32 hartindex)
 	return 0;
 }
 
+int sbi_ipi_raw_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i;
+
+	if (!ipi_dev || !ipi_dev->ipi_send)
+		return SBI_EINVAL;
+
+	/* Same as sbi_ipi_raw_send() */
+	wmb();
+
+	if (ipi_dev->ipi_send_mask) {
+		ipi_dev->ipi_send_mask(mask);
+	} else {
+		sbi_hartmask_for_each_hartindex(i, mask)
+			ipi_dev->ipi_send(i);
+	}
+
+	return 0;
+}
+
+int sbi_ipi_set_hart_cluster(u32 hartindex, u32 cluster)
+{
+	u32 c = cluster + 1;
+
+	if (!sbi_hartindex_valid(hartindex) || SBI_HARTMASK_MAX_BITS <= cluster)
+		return SBI_EINVAL;
+
+	ipi_hart_cluster[hartindex] = c;
+	if (!ipi_cluster_end[c] || hartindex < ipi_cluster_first[c])
+		ipi_cluster_first[c] = hartindex;
+	if (ipi_cluster_end[c] <= hartindex)
+		ipi_cluster_end[c] = hartindex + 1;
+	if (ipi_cluster_max < c)
+		ipi_cluster_max = c;
+
+	return 0;
+}
+
 void sbi_ipi_raw_clear(void)
 {
 	if (ipi_dev && ipi_dev->ipi_clear)
@@ -321,6 +666,18 @@ int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (ret < 0)
 			return ret;
 		ipi_halt_event = ret;
+		if (IPI_TREE_MIN_HARTS) {
+			ipi_fwd_off = sbi_scratch_alloc_offset(
+						sizeof(struct sbi_ipi_fwd));
+			ipi_fwd_pending_off = sbi_scratch_alloc_offset(
+						sizeof(struct sbi_hartmask));
+			if (!ipi_fwd_off || !ipi_fwd_pending_off)
+				return SBI_ENOMEM;
+			ret = sbi_ipi_event_create(&ipi_fwd_ops);
+			if (ret < 0)
+				return ret;
+			ipi_fwd_event = ret;
+		}
 
 		/* Initialize platform IPI support */
 		ret = sbi_platform_ipi_init(sbi_platform_ptr(scratch));
@@ -336,6 +693,9 @@ int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot)
 
 	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
 	ipi_data->ipi_type = 0x00;
+	if (ipi_fwd_pending_off)
+		sbi_memset(sbi_scratch_offset_ptr(scratch, ipi_fwd_pending_off),
+			   0, sizeof(struct sbi_hartmask));
 
 	/* Clear any pending IPIs for the current hart */
 	sbi_ipi_raw_clear();
@@ -0,0 +1,177 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Lock-free multi-producer single-consumer ring
+ *
+ * Producers reserve a slot by advancing the ring tail with a CAS and then
+ * publish the slot by releasing its sequence number. The only consumer
+ * claims published slots in order. No lock is shared between producers
+ * and the consumer, so a remote hart can always make progress regardless
+ * of how many harts are enqueueing at the same time.
+ */
+
+#include <sbi/riscv_barrier.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_mpsc.h>
+#include <sbi/sbi_string.h>
+
+static inline unsigned long *mpsc_slot_seq(struct sbi_mpsc *ring,
+					   unsigned long pos)
+{
+	return (unsigned long *)((char *)ring->queue +
+		(pos % ring->num_entries) * ring->slot_size);
+}
+
+static inline void *mpsc_slot_data(unsigned long *seq)
+{
+	return (char *)seq + sizeof(*seq);
+}
+
+void sbi_mpsc_init(struct sbi_mpsc *ring, void *queue_mem, u16 entries,
+		   u16 entry_size)
+{
+	unsigned long i;
+
+	ring->queue	  = queue_mem;
+	ring->num_entries = entries;
+	ring->entry_size  = entry_size;
+	ring->slot_size	  = SBI_MPSC_SLOT_SIZE(entry_size);
+	ring->head = ring->tail = 0;
+	sbi_memset(ring->queue, 0, SBI_MPSC_MEM_SIZE(entries, entry_size));
+
+	for (i = 0; i < entries; i++)
+		*mpsc_slot_seq(ring, i) = i;
+
+	/* Make initialized slots visible before ring is used remotely */
+	smp_wmb();
+}
+
+int sbi_mpsc_enqueue(struct sbi_mpsc *ring, void *data)
+{
+	unsigned long pos, seq, *slot;
+	long diff;
+
+	if (!ring || !data)
+		return SBI_EINVAL;
+
+	pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	while (1) {
+		slot = mpsc_slot_seq(ring, pos);
+		seq = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+		diff = (long)(seq - pos);
+		if (!diff) {
+			/* Slot is free so try to reserve it */
+			if (__atomic_compare_exchange_n(&ring->tail, &pos,
+							pos + 1, false,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/* Slot still holds an entry of previous lap */
+			return SBI_ENOSPC;
+		} else {
+			/* Another producer got this slot before us */
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	sbi_memcpy(mpsc_slot_data(slot), data, ring->entry_size);
+	__atomic_store_n(slot, pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int sbi_mpsc_dequeue(struct sbi_mpsc *ring, void *data)
+{
+	unsigned long pos, seq, *slot;
+
+	if (!ring || !data)
+		return SBI_EINVAL;
+
+	pos = ring->head;
+	slot = mpsc_slot_seq(ring, pos);
+
+	/*
+	 * Claim the slot so that in-place updates from producers can not
+	 * modify it while we copy it out. A failed claim with BUSY means
+	 * a producer is updating the entry right now so just wait for it.
+	 */
+	do {
+		seq = pos + 1;
+		if (__atomic_compare_exchange_n(slot, &seq, SBI_MPSC_SEQ_BUSY,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			break;
+		if (seq != SBI_MPSC_SEQ_BUSY)
+			return SBI_ENOENT;
+	} while (1);
+
+	sbi_memcpy(data, mpsc_slot_data(slot), ring->entry_size);
+	ring->head = pos + 1;
+
+	/* Hand the slot over to the producer of the next lap */
+	__atomic_store_n(slot, pos + ring->num_entries, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int sbi_mpsc_is_empty(struct sbi_mpsc *ring)
+{
+	if (!ring)
+		return SBI_EINVAL;
+
+	return (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) ==
+		__atomic_load_n(&ring->tail, __ATOMIC_RELAXED)) ? true : false;
+}
+
+u16 sbi_mpsc_avail(struct sbi_mpsc *ring)
+{
+	unsigned long head, tail;
+
+	if (!ring)
+		return 0;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+	return (tail - head < ring->num_entries) ?
+		(u16)(tail - head) : ring->num_entries;
+}
+
+/**
+ * Provide a helper function to do inplace update to the ring.
+ * Note: The callback function is called with the visited slot claimed
+ * and only published entries which are not yet consumed are visited.
+ *
+ * **Do not** invoke any other ring function from callback.
+ */
+int sbi_mpsc_inplace_update(struct sbi_mpsc *ring, void *in,
+			    int (*fptr)(void *in, void *data))
+{
+	unsigned long pos, head, tail, seq, *slot;
+	int ret = SBI_FIFO_UNCHANGED;
+
+	if (!ring || !in)
+		return ret;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	for (pos = head; pos != tail; pos++) {
+		slot = mpsc_slot_seq(ring, pos);
+		seq = pos + 1;
+		/* Skip entries being consumed, updated or not yet published */
+		if (!__atomic_compare_exchange_n(slot, &seq, SBI_MPSC_SEQ_BUSY,
+						 false, __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			continue;
+
+		ret = fptr(in, mpsc_slot_data(slot));
+		__atomic_store_n(slot, pos + 1, __ATOMIC_RELEASE);
+
+		if (ret == SBI_FIFO_SKIP || ret == SBI_FIFO_UPDATED)
+			break;
+	}
+
+	return ret;
+}
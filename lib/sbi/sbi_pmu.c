@@ -57,12 +57,15 @@ union sbi_pmu_ctr_info {
 
 /** Per-HART state of the PMU counters */
 struct sbi_pmu_hart_state {
+	/*
+	 * Bitmap of firmware counters started, kept first for the counter
+	 * CSR read fast path at trap entry
+	 */
+	unsigned long fw_counters_started;
 	/* HART to which this state belongs */
 	uint32_t hartid;
 	/* Counter to enabled event mapping */
 	uint32_t active_events[SBI_PMU_HW_CTR_MAX + SBI_PMU_FW_CTR_MAX];
-	/* Bitmap of firmware counters started */
-	unsigned long fw_counters_started;
 	/* if true, SSE is enabled */
 	bool sse_enabled;
 	/*
@@ -73,17 +76,21 @@ struct sbi_pmu_hart_state {
 	uint64_t fw_counters_data[SBI_PMU_FW_CTR_MAX];
 };
 
+_Static_assert(offsetof(struct sbi_pmu_hart_state, fw_counters_started) == 0,
+	       "fw_counters_started must be first for the trap fast path");
+
 /** Offset of pointer to PMU HART state in scratch space */
-static unsigned long phs_ptr_offset;
+unsigned long sbi_pmu_phs_ptr_offset;
 
 #define pmu_get_hart_state_ptr(__scratch)				\
-	phs_ptr_offset ? sbi_scratch_read_type((__scratch), void *, phs_ptr_offset) : NULL
+	sbi_pmu_phs_ptr_offset ?					\
+	sbi_scratch_read_type((__scratch), void *, sbi_pmu_phs_ptr_offset) : NULL
 
 #define pmu_thishart_state_ptr()					\
 	pmu_get_hart_state_ptr(sbi_scratch_thishart_ptr())
 
 #define pmu_set_hart_state_ptr(__scratch, __phs)			\
-	sbi_scratch_write_type((__scratch), void *, phs_ptr_offset, (__phs))
+	sbi_scratch_write_type((__scratch), void *, sbi_pmu_phs_ptr_offset, (__phs))
 
 /* Platform specific PMU device */
 static const struct sbi_pmu_device *pmu_dev = NULL;
@@ -130,6 +137,20 @@ static bool pmu_event_select_overlap(struct sbi_pmu_hw_event *evt,
 	return false;
 }
 
+/*
+ * Firmware event codes defined by the SBI specification, OpenSBI specific
+ * custom firmware events and the platform firmware event are valid.
+ */
+static inline bool pmu_fw_event_code_valid(uint32_t event_code)
+{
+	if (event_code < SBI_PMU_FW_MAX ||
+	    event_code == SBI_PMU_FW_PLATFORM)
+		return true;
+
+	return (SBI_PMU_FW_IMPL_START <= event_code &&
+		event_code < SBI_PMU_FW_IMPL_MAX) ? true : false;
+}
+
 static int pmu_event_validate(struct sbi_pmu_hart_state *phs,
 			      unsigned long event_idx, uint64_t edata)
 {
@@ -143,9 +164,7 @@ static int pmu_event_validate(struct sbi_pmu_hart_state *phs,
 		event_idx_code_max = SBI_PMU_HW_GENERAL_MAX;
 		break;
 	case SBI_PMU_EVENT_TYPE_FW:
-		if ((event_idx_code >= SBI_PMU_FW_MAX &&
-		    event_idx_code <= SBI_PMU_FW_RESERVED_MAX) ||
-		    event_idx_code > SBI_PMU_FW_PLATFORM)
+		if (!pmu_fw_event_code_valid(event_idx_code))
 			return SBI_EINVAL;
 
 		if (SBI_PMU_FW_PLATFORM == event_idx_code &&
@@ -153,7 +172,7 @@ static int pmu_event_validate(struct sbi_pmu_hart_state *phs,
 			return pmu_dev->fw_event_validate_encoding(phs->hartid,
 							           edata);
 		else
-			event_idx_code_max = SBI_PMU_FW_MAX;
+			event_idx_code_max = SBI_PMU_FW_IMPL_MAX;
 		break;
 	case SBI_PMU_EVENT_TYPE_HW_CACHE:
 		cache_ops_result = event_idx_code &
@@ -217,9 +236,7 @@ int sbi_pmu_ctr_fw_read(uint32_t cidx, uint64_t *cval)
 	if (event_idx_type != SBI_PMU_EVENT_TYPE_FW)
 		return SBI_EINVAL;
 
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code) {
@@ -414,9 +431,7 @@ static int pmu_ctr_start_fw(struct sbi_pmu_hart_state *phs,
 			    uint64_t event_data, uint64_t ival,
 			    bool ival_update)
 {
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code) {
@@ -518,9 +533,7 @@ static int pmu_ctr_stop_fw(struct sbi_pmu_hart_state *phs,
 {
 	int ret;
 
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code &&
@@ -792,9 +805,7 @@ static int pmu_ctr_find_fw(struct sbi_pmu_hart_state *phs,
 {
 	int i, cidx;
 
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	for_each_set_bit(i, &cmask, BITS_PER_LONG) {
@@ -907,7 +918,8 @@ int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 	if (likely(!phs->fw_counters_started))
 		return 0;
 
-	if (unlikely(fw_id >= SBI_PMU_FW_MAX))
+	if (unlikely(!pmu_fw_event_code_valid(fw_id) ||
+		     fw_id == SBI_PMU_FW_PLATFORM))
 		return SBI_EINVAL;
 
 	for (cidx = num_hw_ctrs; cidx < total_ctrs; cidx++) {
@@ -1055,8 +1067,8 @@ int sbi_pmu_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (!hw_event_map)
 			return SBI_ENOMEM;
 
-		phs_ptr_offset = sbi_scratch_alloc_type_offset(void *);
-		if (!phs_ptr_offset) {
+		sbi_pmu_phs_ptr_offset = sbi_scratch_alloc_type_offset(void *);
+		if (!sbi_pmu_phs_ptr_offset) {
 			sbi_free(hw_event_map);
 			return SBI_ENOMEM;
 		}
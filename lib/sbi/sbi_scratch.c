@@ -21,7 +21,28 @@ struct sbi_scratch *hartindex_to_scratch_table[SBI_HARTMASK_MAX_BITS + 1] = { 0
 static spinlock_t extra_lock = SPIN_LOCK_INITIALIZER;
 static unsigned long extra_offset = SBI_SCRATCH_EXTRA_SPACE_OFFSET;
 
-u32 sbi_hartid_to_hartindex(u32 hartid)
+/*
+ * HART id to HART index lookup uses a two-level radix table built at
+ * boot time over the range of HART ids present. The directory is indexed
+ * by the upper bits of (hartid - base) and holds 1-based leaf numbers.
+ * Each leaf holds the HART indices of HARTID_LEAF_SIZE consecutive HART
+ * ids. If the HART ids are spread too far apart for the directory, the
+ * lookup falls back to a linear scan of hartindex_to_hartid_table.
+ */
+#define HARTID_LEAF_SHIFT	3
+#define HARTID_LEAF_SIZE	(1U << HARTID_LEAF_SHIFT)
+#define HARTID_LEAF_MASK	(HARTID_LEAF_SIZE - 1)
+#define HARTID_DIR_SIZE		(SBI_HARTMASK_MAX_BITS * 4)
+#define HARTID_LEAF_INVALID	0xffff
+
+static bool hartid_lookup_ready;
+static bool hartid_lookup_linear;
+static u32 hartid_lookup_base;
+static u32 hartid_lookup_span;
+static u16 hartid_lookup_dir[HARTID_DIR_SIZE];
+static u16 hartid_lookup_leaf[SBI_HARTMASK_MAX_BITS][HARTID_LEAF_SIZE];
+
+static u32 hartid_to_hartindex_scan(u32 hartid)
 {
 	u32 i;
 
@@ -32,6 +53,79 @@ u32 sbi_hartid_to_hartindex(u32 hartid)
 	return -1U;
 }
 
+u32 sbi_hartid_to_hartindex(u32 hartid)
+{
+	u32 off = hartid - hartid_lookup_base;
+	u16 leaf, ret;
+
+	if (likely(off < hartid_lookup_span)) {
+		leaf = hartid_lookup_dir[off >> HARTID_LEAF_SHIFT];
+		if (!leaf)
+			return -1U;
+		ret = hartid_lookup_leaf[leaf - 1][off & HARTID_LEAF_MASK];
+		return (ret == HARTID_LEAF_INVALID) ? -1U : ret;
+	}
+
+	return hartid_lookup_ready ? -1U : hartid_to_hartindex_scan(hartid);
+}
+
+bool sbi_hartid_is_linear(u32 *base)
+{
+	if (!hartid_lookup_linear)
+		return false;
+
+	*base = hartid_lookup_base;
+	return true;
+}
+
+static void hartid_lookup_init(u32 hart_count)
+{
+	u32 i, h, off, min = -1U, max = 0;
+	u16 leaf, leaf_count = 0;
+	bool linear = true;
+
+	for (i = 0; i < hart_count; i++) {
+		h = hartindex_to_hartid_table[i];
+		if (h == -1U || h != hartindex_to_hartid_table[0] + i)
+			linear = false;
+		if (h == -1U)
+			continue;
+		if (h < min)
+			min = h;
+		if (max < h)
+			max = h;
+	}
+
+	if (max < min ||
+	    ((u64)HARTID_DIR_SIZE << HARTID_LEAF_SHIFT) <= (u64)(max - min))
+		return;
+
+	for (i = 0; i < hart_count; i++) {
+		h = hartindex_to_hartid_table[i];
+		if (h == -1U)
+			continue;
+
+		off = h - min;
+		leaf = hartid_lookup_dir[off >> HARTID_LEAF_SHIFT];
+		if (!leaf) {
+			leaf = ++leaf_count;
+			hartid_lookup_dir[off >> HARTID_LEAF_SHIFT] = leaf;
+			sbi_memset(hartid_lookup_leaf[leaf - 1], 0xff,
+				   sizeof(hartid_lookup_leaf[0]));
+		}
+
+		/* Lowest HART index wins, same as the linear scan */
+		off &= HARTID_LEAF_MASK;
+		if (hartid_lookup_leaf[leaf - 1][off] == HARTID_LEAF_INVALID)
+			hartid_lookup_leaf[leaf - 1][off] = i;
+	}
+
+	hartid_lookup_base = min;
+	hartid_lookup_span = max - min + 1;
+	hartid_lookup_linear = linear;
+	hartid_lookup_ready = true;
+}
+
 typedef struct sbi_scratch *(*hartid2scratch)(ulong hartid, ulong hartindex);
 
 int sbi_scratch_init(struct sbi_scratch *scratch)
@@ -47,6 +141,7 @@ int sbi_scratch_init(struct sbi_scratch *scratch)
 	}
 
 	last_hartindex_having_scratch = plat->hart_count - 1;
+	hartid_lookup_init(plat->hart_count);
 
 	return 0;
 }
@@ -633,6 +633,16 @@ out:
 	spin_unlock(&state->enabled_event_lock);
 }
 
+bool sbi_sse_events_enabled(void)
+{
+	struct sse_hart_state *state = sse_thishart_state_ptr();
+
+	if (!state || state->masked)
+		return false;
+
+	return !sbi_list_empty(&state->enabled_event_list);
+}
+
 static int sse_event_set_pending(struct sbi_sse_event *e)
 {
 	if (sse_event_state(e) != SBI_SSE_STATE_RUNNING &&
@@ -18,7 +18,19 @@
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
 
+#ifdef CONFIG_SBI_TRAP_CSR_FASTPATH
+#define TRAP_CSR_FASTPATH	true
+#else
+#define TRAP_CSR_FASTPATH	false
+#endif
+
 static unsigned long time_delta_off;
+
+/*
+ * Offset of the per-HART timer MMIO word (see timer_value_mmio) used
+ * by the counter CSR read fast path at trap entry, zero if disabled.
+ */
+unsigned long sbi_timer_fast_off;
 static u64 (*get_time_val)(void);
 static const struct sbi_timer_device *timer_dev = NULL;
 
@@ -179,6 +191,22 @@ void sbi_timer_set_device(const struct sbi_timer_device *dev)
 		get_time_val = timer_dev->timer_value;
 }
 
+static void sbi_timer_fast_init(struct sbi_scratch *scratch)
+{
+	unsigned long *fast;
+
+	if (!sbi_timer_fast_off)
+		return;
+
+	/* The fast path checks MCOUNTEREN which older harts don't have */
+	fast = sbi_scratch_offset_ptr(scratch, sbi_timer_fast_off);
+	if (timer_dev && timer_dev->timer_value_mmio &&
+	    sbi_hart_priv_version(scratch) >= SBI_HART_PRIV_VER_1_10)
+		*fast = timer_dev->timer_value_mmio();
+	else
+		*fast = 0;
+}
+
 int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	u64 *time_delta;
@@ -190,6 +218,11 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (!time_delta_off)
 			return SBI_ENOMEM;
 
+		/* Without space for it, the fast path stays disabled */
+		if (TRAP_CSR_FASTPATH)
+			sbi_timer_fast_off =
+				sbi_scratch_alloc_type_offset(unsigned long);
+
 		if (sbi_hart_has_extension(scratch, SBI_HART_EXT_ZICNTR))
 			get_time_val = get_ticks;
 
@@ -210,6 +243,8 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 			return ret;
 	}
 
+	sbi_timer_fast_init(scratch);
+
 	return 0;
 }
 
@@ -11,11 +11,14 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_atomic.h>
 #include <sbi/riscv_barrier.h>
+#include <sbi/sbi_bitmap.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_ipi.h>
+#include <sbi/sbi_mpsc.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_tlb.h>
 #include <sbi/sbi_hfence.h>
@@ -23,17 +26,298 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
+#include <sbi/sbi_timer.h>
+#include <sbi/sbi_trap_ldst.h>
 
 static unsigned long tlb_sync_off;
 static unsigned long tlb_fifo_off;
 static unsigned long tlb_fifo_mem_off;
-static unsigned long tlb_range_flush_limit;
+static u64 tlb_range_flush_limit;
+static unsigned long tlb_bcast_off;
+static unsigned long tlb_bcast_pending_off;
+static unsigned long tlb_limit_off;
+static unsigned long tlb_wait_off;
+static unsigned long tlb_resid_off;
+static unsigned long tlb_full_off;
+static unsigned long tlb_stats_off;
+static u32 tlb_event = SBI_IPI_EVENT_MAX;
+static u32 tlb_bcast_event = SBI_IPI_EVENT_MAX;
+
+/*
+ * Once a remote fifo holds this many entries, VMID scoped hypervisor
+ * fences for the same VMID are promoted to a single VMID-wide flush.
+ */
+#define TLB_FIFO_HIGH_WATERMARK(__n)	(((__n) * 3) / 4)
+
+/*
+ * Per-hart range flush limits (in bytes) for each fence type. A range
+ * larger than the limit is flushed entirely by the receiving hart.
+ */
+struct tlb_flush_limit {
+	bool calibrated;
+	unsigned long limit[SBI_TLB_TYPE_MAX];
+};
+
+/* Number of pages flushed one at a time while calibrating */
+#define TLB_CALIBRATE_PAGES		16
+/* Number of rounds per measurement, the fastest round is used */
+#define TLB_CALIBRATE_ROUNDS		4
+/* Upper bound of a calibrated range flush limit (in pages) */
+#define TLB_CALIBRATE_MAX_PAGES		512
+/*
+ * A full flush also throws away unrelated translations which have to be
+ * refilled later, so its measured cost is scaled by this factor.
+ */
+#define TLB_CALIBRATE_REFILL_FACTOR	2
+
+/* Fence classes of the sticky full flush pending state */
+#define TLB_FULL_SFENCE		(1UL << 0)
+#define TLB_FULL_HFENCE_GVMA	(1UL << 1)
+#define TLB_FULL_FENCE_I	(1UL << 2)
+
+/*
+ * Requests which do not fit in the fifo of a hart are folded into its
+ * sticky full flush pending state. HFENCE.VVMA only applies to one VMID,
+ * so its state records the VMID (plus one) instead of a class bit.
+ * Harts which folded a request wait for it to complete like for a fifo
+ * entry and are tracked in the senders hartmask.
+ */
+struct tlb_full_pending {
+	unsigned long classes;
+	unsigned long vvma_vmid;
+	struct sbi_hartmask senders;
+};
+
+_Static_assert(SBI_HARTMASK_MAX_BITS <= SBI_TLB_INFO_NO_SRC,
+	       "HART indices do not fit in sbi_tlb_info.src");
+
+/*
+ * Maximum number of waits for a full remote fifo to drain before giving
+ * a request which can not be folded back to sbi_ipi_send_many() for a
+ * retry.
+ */
+#define TLB_FIFO_FULL_WAIT_LOOPS	64
+
+#ifdef CONFIG_SBI_TLB_BCAST_MIN_HARTS
+#define TLB_BCAST_MIN_HARTS	CONFIG_SBI_TLB_BCAST_MIN_HARTS
+#else
+#define TLB_BCAST_MIN_HARTS	4
+#endif
+
+/*
+ * Shared remote fence descriptor published by the issuing hart in its
+ * own scratch space. Target harts only get the issuing hart index set in
+ * their pending bitmap and signal completion by decrementing the
+ * descriptor pending count.
+ */
+struct tlb_bcast_desc {
+	struct sbi_tlb_info info;
+	atomic_t pending;
+};
+
+#ifdef CONFIG_SBI_TLB_LAZY_FENCE
+#define TLB_LAZY_FENCE		true
+#else
+#define TLB_LAZY_FENCE		false
+#endif
+
+#ifdef CONFIG_SBI_TLB_STATS
+#define TLB_STATS		true
+#else
+#define TLB_STATS		false
+#endif
+
+/* Per-hart rfence latency statistics allocated from the heap */
+struct tlb_stats_state {
+	u64 req_time;
+	u32 req_type;
+	struct sbi_tlb_stats stats;
+};
+
+#define TLB_RESID_ASID_BITS	256
+#define TLB_RESID_VMID_BITS	64
+
+/*
+ * ASIDs and VMIDs possibly held in the TLB of a hart which opted in for
+ * lazy remote fences. The maps are hashed so a set bit only means that
+ * the hart may hold entries for an ASID or VMID. The maps are written
+ * by the owner hart only and read by harts sending remote fences.
+ */
+struct tlb_residency {
+	bool enabled;
+	unsigned long asids[BITS_TO_LONGS(TLB_RESID_ASID_BITS)];
+	unsigned long vmids[BITS_TO_LONGS(TLB_RESID_VMID_BITS)];
+};
 
 static void tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
 }
 
+static inline unsigned long tlb_current_asid(void)
+{
+	return (csr_read(CSR_SATP) & SATP_ASID) >> SATP_ASID_SHIFT;
+}
+
+static inline unsigned long tlb_current_vmid(void)
+{
+	return (csr_read(CSR_HGATP) & HGATP_VMID_MASK) >> HGATP_VMID_SHIFT;
+}
+
+/*
+ * Reset a map to only contain the given bit. Each word is written once so
+ * the bit never appears cleared to remote harts.
+ */
+static void tlb_resid_reset(unsigned long *map, int nbits, int bit)
+{
+	int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+		map[i] = (i == BIT_WORD(bit)) ? BIT(BIT_WORD_OFFSET(bit)) : 0;
+}
+
+/* Called on the local hart after a full SFENCE.VMA */
+static void tlb_resid_flushed_all(void)
+{
+	struct tlb_residency *res;
+
+	if (!TLB_LAZY_FENCE)
+		return;
+
+	res = sbi_scratch_thishart_offset_ptr(tlb_resid_off);
+	if (res->enabled)
+		tlb_resid_reset(res->asids, TLB_RESID_ASID_BITS,
+				tlb_current_asid() % TLB_RESID_ASID_BITS);
+}
+
+/* Check whether a remote fence can be skipped for the remote hart */
+static bool tlb_resid_skip(struct sbi_scratch *rscratch,
+			   struct sbi_tlb_info *tinfo)
+{
+	struct tlb_residency *res;
+
+	if (!TLB_LAZY_FENCE)
+		return false;
+
+	res = sbi_scratch_offset_ptr(rscratch, tlb_resid_off);
+	if (!__atomic_load_n(&res->enabled, __ATOMIC_ACQUIRE))
+		return false;
+
+	/*
+	 * Order page table updates done by the caller before reading the
+	 * maps. Pairs with the smp_mb() in sbi_tlb_residency_hint().
+	 */
+	smp_mb();
+
+	switch (tinfo->type) {
+	case SBI_TLB_SFENCE_VMA_ASID:
+		return !bitmap_test(res->asids,
+				    tinfo->asid % TLB_RESID_ASID_BITS);
+	case SBI_TLB_HFENCE_GVMA_VMID:
+	case SBI_TLB_HFENCE_VVMA_ASID:
+	case SBI_TLB_HFENCE_VVMA:
+		return !bitmap_test(res->vmids,
+				    tinfo->vmid % TLB_RESID_VMID_BITS);
+	default:
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * Opt-in of the calling hart for lazy remote fences. From then on, the
+ * supervisor must report every ASID and VMID it starts using on this hart
+ * with sbi_tlb_residency_hint() before using it. VS-stage entries are not
+ * flushed for other VMIDs so this must be called before running guests.
+ */
+int sbi_tlb_residency_enable(void)
+{
+	struct tlb_residency *res;
+
+	if (!TLB_LAZY_FENCE)
+		return SBI_ENOTSUPP;
+
+	res = sbi_scratch_thishart_offset_ptr(tlb_resid_off);
+	if (res->enabled)
+		return 0;
+
+	/* Start with an empty TLB so that the maps hold every resident ID */
+	tlb_flush_all();
+	tlb_resid_reset(res->asids, TLB_RESID_ASID_BITS,
+			tlb_current_asid() % TLB_RESID_ASID_BITS);
+	if (misa_extension('H')) {
+		__sbi_hfence_gvma_all();
+		tlb_resid_reset(res->vmids, TLB_RESID_VMID_BITS,
+				tlb_current_vmid() % TLB_RESID_VMID_BITS);
+	} else {
+		bitmap_zero(res->vmids, TLB_RESID_VMID_BITS);
+	}
+
+	__atomic_store_n(&res->enabled, true, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int sbi_tlb_residency_hint(unsigned long asid, unsigned long vmid)
+{
+	struct tlb_residency *res;
+	unsigned long hgatp;
+	int bit;
+
+	if (!TLB_LAZY_FENCE)
+		return SBI_ENOTSUPP;
+
+	res = sbi_scratch_thishart_offset_ptr(tlb_resid_off);
+	if (!res->enabled)
+		return SBI_EINVALID_STATE;
+	if (vmid != -1UL && !misa_extension('H'))
+		return SBI_EINVAL;
+
+	/*
+	 * A hart sending a remote fence may have missed the new bit, so
+	 * order the implicit reads of the newly used ASID or VMID after the
+	 * page table updates done before that remote fence.
+	 */
+	if (asid != -1UL) {
+		bit = asid % TLB_RESID_ASID_BITS;
+		if (!bitmap_test(res->asids, bit)) {
+			bitmap_set(res->asids, bit, 1);
+			smp_mb();
+			__asm__ __volatile__("sfence.vma x0, %0"
+					     :
+					     : "r"(asid)
+					     : "memory");
+		}
+	}
+
+	if (vmid != -1UL) {
+		bit = vmid % TLB_RESID_VMID_BITS;
+		if (!bitmap_test(res->vmids, bit)) {
+			bitmap_set(res->vmids, bit, 1);
+			smp_mb();
+			__sbi_hfence_gvma_vmid(vmid);
+			hgatp = csr_swap(CSR_HGATP,
+				(vmid << HGATP_VMID_SHIFT) & HGATP_VMID_MASK);
+			__sbi_hfence_vvma_all();
+			csr_write(CSR_HGATP, hgatp);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * With Svinval, a range is invalidated with SINVAL.VMA/HINVAL.* bracketed
+ * by SFENCE.W.INVAL and SFENCE.INVAL.IR so that the ordering cost is paid
+ * once per request instead of once per page.
+ */
+static inline bool tlb_has_svinval(void)
+{
+	return sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				      SBI_HART_EXT_SVINVAL);
+}
+
 static void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
@@ -51,6 +335,14 @@ static void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_vvma_va(start + i);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_vvma_va(start+i);
 	}
@@ -72,6 +364,14 @@ static void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_gvma_gpa((start + i) >> 2);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_gvma_gpa((start + i) >> 2);
 	}
@@ -87,6 +387,15 @@ static void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 
 	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
 		tlb_flush_all();
+		tlb_resid_flushed_all();
+		return;
+	}
+
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_sinval_vma_va(start + i);
+		__sbi_sfence_inval_ir();
 		return;
 	}
 
@@ -116,6 +425,14 @@ static void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_vvma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_vvma_asid_va(start + i, asid);
 	}
@@ -138,6 +455,14 @@ static void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_gvma_vmid_gpa((start + i) >> 2, vmid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_gvma_vmid_gpa((start + i) >> 2, vmid);
 	}
@@ -161,6 +486,14 @@ static void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_sinval_vma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__asm__ __volatile__("sfence.vma %0, %1"
 				     :
@@ -174,13 +507,11 @@ static void sbi_tlb_local_fence_i(struct sbi_tlb_info *tinfo)
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_I_RECVD);
 
 	__asm__ __volatile("fence.i");
+	sbi_trap_ldst_cache_flush();
 }
 
-static void tlb_entry_local_process(struct sbi_tlb_info *data)
+static void __tlb_entry_local_process(struct sbi_tlb_info *data)
 {
-	if (unlikely(!data))
-		return;
-
 	switch (data->type) {
 	case SBI_TLB_FENCE_I:
 		sbi_tlb_local_fence_i(data);
@@ -208,31 +539,382 @@ static void tlb_entry_local_process(struct sbi_tlb_info *data)
 	};
 }
 
+static void tlb_entry_local_process(struct sbi_tlb_info *data)
+{
+	struct tlb_flush_limit *fl;
+	struct sbi_tlb_info full;
+
+	if (unlikely(!data))
+		return;
+
+	/*
+	 * Upgrade a range flush which is too big for this hart to a full
+	 * flush on a local copy because the entry may be shared with other
+	 * harts having different limits.
+	 */
+	fl = sbi_scratch_thishart_offset_ptr(tlb_limit_off);
+	if (data->size != SBI_TLB_FLUSH_ALL &&
+	    data->type < SBI_TLB_TYPE_MAX &&
+	    data->size > fl->limit[data->type]) {
+		full = *data;
+		full.start = 0;
+		full.size = SBI_TLB_FLUSH_ALL;
+		data = &full;
+	}
+
+	__tlb_entry_local_process(data);
+}
+
+static unsigned long tlb_calibrate_cycles(struct sbi_tlb_info *tinfo)
+{
+	unsigned long i, t, best = -1UL;
+
+	for (i = 0; i < TLB_CALIBRATE_ROUNDS; i++) {
+		t = csr_read(CSR_MCYCLE);
+		__tlb_entry_local_process(tinfo);
+		t = csr_read(CSR_MCYCLE) - t;
+		if (t < best)
+			best = t;
+	}
+
+	return best;
+}
+
+/*
+ * Time the per-page loop against a full flush for each fence type and
+ * pick the range size beyond which a full flush is cheaper on this hart.
+ */
+static void tlb_calibrate_limits(struct tlb_flush_limit *fl)
+{
+	unsigned long full_cycles, range_cycles, pages;
+	struct sbi_tlb_info tinfo;
+	u32 type;
+
+	for (type = 0; type < SBI_TLB_TYPE_MAX; type++) {
+		if (type == SBI_TLB_FENCE_I) {
+			fl->limit[type] = -1UL;
+			continue;
+		}
+		if (type >= SBI_TLB_HFENCE_GVMA_VMID && !misa_extension('H')) {
+			fl->limit[type] = 0;
+			continue;
+		}
+
+		SBI_TLB_INFO_INIT(&tinfo, 0, SBI_TLB_FLUSH_ALL, 0, 0,
+				  type, current_hartid());
+		full_cycles = tlb_calibrate_cycles(&tinfo);
+
+		tinfo.size = TLB_CALIBRATE_PAGES * PAGE_SIZE;
+		range_cycles = tlb_calibrate_cycles(&tinfo);
+
+		/* Cycle counter not available so fallback to single page */
+		if (!full_cycles || !range_cycles) {
+			fl->limit[type] = PAGE_SIZE;
+			continue;
+		}
+
+		pages = (full_cycles * TLB_CALIBRATE_REFILL_FACTOR *
+			 TLB_CALIBRATE_PAGES) / range_cycles;
+		if (pages < 1)
+			pages = 1;
+		if (pages > TLB_CALIBRATE_MAX_PAGES)
+			pages = TLB_CALIBRATE_MAX_PAGES;
+		fl->limit[type] = pages * PAGE_SIZE;
+	}
+}
+
+void sbi_tlb_get_flush_limits_str(struct sbi_scratch *scratch,
+				  char *limits_str, int nlimits_str)
+{
+	static const char * const names[SBI_TLB_TYPE_MAX] = {
+		[SBI_TLB_SFENCE_VMA] = "vma",
+		[SBI_TLB_SFENCE_VMA_ASID] = "vma_asid",
+		[SBI_TLB_HFENCE_GVMA_VMID] = "gvma_vmid",
+		[SBI_TLB_HFENCE_GVMA] = "gvma",
+		[SBI_TLB_HFENCE_VVMA_ASID] = "vvma_asid",
+		[SBI_TLB_HFENCE_VVMA] = "vvma",
+	};
+	struct tlb_flush_limit *fl;
+	int type, offset = 0;
+
+	if (!limits_str || nlimits_str <= 0)
+		return;
+	sbi_memset(limits_str, 0, nlimits_str);
+
+	if (!tlb_limit_off) {
+		sbi_snprintf(limits_str, nlimits_str, "none");
+		return;
+	}
+
+	fl = sbi_scratch_offset_ptr(scratch, tlb_limit_off);
+	for (type = 0; type < SBI_TLB_TYPE_MAX; type++) {
+		if (!names[type] || offset >= nlimits_str)
+			continue;
+		if (type >= SBI_TLB_HFENCE_GVMA_VMID && !misa_extension('H'))
+			continue;
+		if (fl->limit[type] == -1UL)
+			offset += sbi_snprintf(limits_str + offset,
+					       nlimits_str - offset, "%s%s:max",
+					       offset ? " " : "", names[type]);
+		else
+			offset += sbi_snprintf(limits_str + offset,
+					       nlimits_str - offset, "%s%s:%lu",
+					       offset ? " " : "", names[type],
+					       fl->limit[type] / PAGE_SIZE);
+	}
+}
+
+static inline unsigned long tlb_load_reserved(volatile unsigned long *ptr)
+{
+	unsigned long val;
+
+#if __riscv_xlen == 64
+	__asm__ __volatile__("lr.d %0, %1" : "=r"(val) : "A"(*ptr) : "memory");
+#else
+	__asm__ __volatile__("lr.w %0, %1" : "=r"(val) : "A"(*ptr) : "memory");
+#endif
+
+	return val;
+}
+
+/*
+ * Wake up a hart waiting in WFI for its requests to complete. Harts
+ * using Zawrs are woken up by the store to the counter they wait on.
+ */
+static void tlb_wake(struct sbi_scratch *rscratch)
+{
+	unsigned long *rwaiting = sbi_scratch_offset_ptr(rscratch, tlb_wait_off);
+
+	/* Pairs with the smp_mb() in tlb_wait() */
+	smp_mb();
+	if (__atomic_load_n(rwaiting, __ATOMIC_RELAXED))
+		sbi_ipi_raw_send(rscratch->hartindex);
+}
+
+static inline struct tlb_stats_state *tlb_stats_ptr(struct sbi_scratch *scratch)
+{
+	if (!TLB_STATS || !scratch)
+		return NULL;
+
+	return sbi_scratch_read_type(scratch, void *, tlb_stats_off);
+}
+
+static inline unsigned long tlb_stats_cycles(void)
+{
+	return TLB_STATS ? csr_read(CSR_MCYCLE) : 0;
+}
+
+static void tlb_stats_add(struct sbi_scratch *scratch, u32 phase, u32 type,
+			  unsigned long val)
+{
+	struct tlb_stats_state *st = tlb_stats_ptr(scratch);
+	u32 bucket = 0;
+
+	if (!st || type >= SBI_TLB_TYPE_MAX)
+		return;
+
+	if (val) {
+		bucket = sbi_fls(val);
+		if (bucket >= SBI_TLB_STAT_BUCKETS)
+			bucket = SBI_TLB_STAT_BUCKETS - 1;
+	}
+
+	/* Only the owner hart updates its histograms */
+	st->stats.hist[phase][type][bucket]++;
+}
+
+/*
+ * Process a request of the sender hart on the local hart and account its
+ * delivery and processing time.
+ */
+static void tlb_entry_local_process_timed(struct sbi_scratch *scratch,
+					  struct sbi_scratch *sscratch,
+					  struct sbi_tlb_info *tinfo)
+{
+	struct tlb_stats_state *sst = tlb_stats_ptr(sscratch);
+	unsigned long cycles;
+
+	if (!TLB_STATS) {
+		tlb_entry_local_process(tinfo);
+		return;
+	}
+
+	/*
+	 * The sender may have moved on to its next request already, which
+	 * only makes this sample shorter.
+	 */
+	if (sst)
+		tlb_stats_add(scratch, SBI_TLB_STAT_DELIVERY, tinfo->type,
+			      sbi_timer_value() - sst->req_time);
+
+	cycles = tlb_stats_cycles();
+	tlb_entry_local_process(tinfo);
+	tlb_stats_add(scratch, SBI_TLB_STAT_PROCESS, tinfo->type,
+		      tlb_stats_cycles() - cycles);
+}
+
+const struct sbi_tlb_stats *sbi_tlb_stats_get(u32 hartindex)
+{
+	struct tlb_stats_state *st =
+		tlb_stats_ptr(sbi_hartindex_to_scratch(hartindex));
+
+	return st ? &st->stats : NULL;
+}
+
+void sbi_tlb_stats_reset(u32 hartindex)
+{
+	struct tlb_stats_state *st =
+		tlb_stats_ptr(sbi_hartindex_to_scratch(hartindex));
+
+	if (st)
+		sbi_memset(&st->stats, 0, sizeof(st->stats));
+}
+
 static void tlb_entry_process(struct sbi_tlb_info *tinfo)
 {
-	u32 rindex;
+	u32 i;
 	struct sbi_scratch *rscratch = NULL;
 	atomic_t *rtlb_sync = NULL;
 
-	tlb_entry_local_process(tinfo);
+	if (TLB_STATS) {
+		rscratch = sbi_hartindex_to_scratch(tinfo->src[0]);
+		tlb_entry_local_process_timed(sbi_scratch_thishart_ptr(),
+					      rscratch, tinfo);
+	} else {
+		tlb_entry_local_process(tinfo);
+	}
+
+	for (i = 0; i < SBI_TLB_INFO_MAX_SRC; i++) {
+		rscratch = sbi_hartindex_to_scratch(tinfo->src[i]);
+		if (!rscratch)
+			continue;
 
-	sbi_hartmask_for_each_hartindex(rindex, &tinfo->smask) {
+		rtlb_sync = sbi_scratch_offset_ptr(rscratch, tlb_sync_off);
+		if (!atomic_sub_return(rtlb_sync, 1))
+			tlb_wake(rscratch);
+	}
+}
+
+static void tlb_full_process(struct sbi_scratch *scratch)
+{
+	u32 rindex;
+	bool pending;
+	unsigned long classes, vvma_vmid, hgatp;
+	struct sbi_hartmask senders;
+	struct sbi_scratch *rscratch;
+	atomic_t *rtlb_sync;
+	struct tlb_full_pending *full =
+			sbi_scratch_offset_ptr(scratch, tlb_full_off);
+
+	/*
+	 * Take the senders before the fence classes. A sender publishes
+	 * its fence class (or VMID) after its own page table and code
+	 * stores, and itself after the class. So a class seen here may be
+	 * flushed right away, even before its sender shows up, and every
+	 * sender taken here has its class flushed now or flushed earlier
+	 * after its stores were visible.
+	 */
+	pending = sbi_hartmask_atomic_take(&full->senders, &senders);
+	if (!pending &&
+	    !__atomic_load_n(&full->classes, __ATOMIC_RELAXED) &&
+	    !__atomic_load_n(&full->vvma_vmid, __ATOMIC_RELAXED))
+		return;
+
+	classes = atomic_raw_xchg_ulong(&full->classes, 0);
+	vvma_vmid = atomic_raw_xchg_ulong(&full->vvma_vmid, 0);
+
+	if (classes & TLB_FULL_FENCE_I) {
+		__asm__ __volatile("fence.i");
+		sbi_trap_ldst_cache_flush();
+	}
+	if (classes & TLB_FULL_SFENCE) {
+		tlb_flush_all();
+		tlb_resid_flushed_all();
+	}
+	if (classes & TLB_FULL_HFENCE_GVMA)
+		__sbi_hfence_gvma_all();
+	if (vvma_vmid) {
+		hgatp = csr_swap(CSR_HGATP, ((vvma_vmid - 1) << HGATP_VMID_SHIFT) &
+					    HGATP_VMID_MASK);
+		__sbi_hfence_vvma_all();
+		csr_write(CSR_HGATP, hgatp);
+	}
+
+	sbi_hartmask_for_each_hartindex(rindex, &senders) {
 		rscratch = sbi_hartindex_to_scratch(rindex);
 		if (!rscratch)
 			continue;
 
 		rtlb_sync = sbi_scratch_offset_ptr(rscratch, tlb_sync_off);
-		atomic_sub_return(rtlb_sync, 1);
+		if (!atomic_sub_return(rtlb_sync, 1))
+			tlb_wake(rscratch);
 	}
 }
 
+/*
+ * Fold a request into the full flush pending state of a remote hart whose
+ * fifo is full. Returns false if the request can not be folded.
+ */
+static bool tlb_full_fold(struct sbi_scratch *scratch,
+			  struct sbi_scratch *remote_scratch,
+			  struct sbi_tlb_info *tinfo)
+{
+	unsigned long class = 0, vmid, old;
+	atomic_t *tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
+	struct tlb_full_pending *rfull =
+			sbi_scratch_offset_ptr(remote_scratch, tlb_full_off);
+
+	/*
+	 * The remote hart may flush as soon as it sees the class, so order
+	 * the stores of the caller before it. A VMID already pending for
+	 * another sender is only read, and a flush of it taking it later
+	 * also comes after our stores.
+	 */
+	smp_mb();
+
+	switch (tinfo->type) {
+	case SBI_TLB_FENCE_I:
+		class = TLB_FULL_FENCE_I;
+		break;
+	case SBI_TLB_SFENCE_VMA:
+	case SBI_TLB_SFENCE_VMA_ASID:
+		class = TLB_FULL_SFENCE;
+		break;
+	case SBI_TLB_HFENCE_GVMA_VMID:
+	case SBI_TLB_HFENCE_GVMA:
+		class = TLB_FULL_HFENCE_GVMA;
+		break;
+	case SBI_TLB_HFENCE_VVMA_ASID:
+	case SBI_TLB_HFENCE_VVMA:
+		vmid = (unsigned long)tinfo->vmid + 1;
+		old = 0;
+		if (!__atomic_compare_exchange_n(&rfull->vvma_vmid, &old, vmid,
+						 false, __ATOMIC_RELAXED,
+						 __ATOMIC_RELAXED) &&
+		    old != vmid)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	atomic_add_return(tlb_sync, 1);
+	if (class)
+		__atomic_fetch_or(&rfull->classes, class, __ATOMIC_RELAXED);
+	/* Publish the fence class before the sender */
+	smp_wmb();
+	sbi_hartmask_atomic_set_hartindex(scratch->hartindex, &rfull->senders);
+
+	return true;
+}
+
 static bool tlb_process_once(struct sbi_scratch *scratch)
 {
 	struct sbi_tlb_info tinfo;
-	struct sbi_fifo *tlb_fifo =
+	struct sbi_mpsc *tlb_fifo =
 			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
-	if (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
+	if (!sbi_mpsc_dequeue(tlb_fifo, &tinfo)) {
 		tlb_entry_process(&tinfo);
 		return true;
 	}
@@ -240,25 +922,214 @@ static bool tlb_process_once(struct sbi_scratch *scratch)
 	return false;
 }
 
+static void tlb_bcast_process(struct sbi_scratch *scratch)
+{
+	u32 rindex;
+	struct sbi_hartmask srcs;
+	struct sbi_scratch *rscratch;
+	struct tlb_bcast_desc *rdesc;
+	struct sbi_hartmask *pending =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_pending_off);
+
+	if (!sbi_hartmask_atomic_take(pending, &srcs))
+		return;
+
+	sbi_hartmask_for_each_hartindex(rindex, &srcs) {
+		rscratch = sbi_hartindex_to_scratch(rindex);
+		if (!rscratch)
+			continue;
+
+		rdesc = sbi_scratch_offset_ptr(rscratch, tlb_bcast_off);
+		tlb_entry_local_process_timed(scratch, rscratch, &rdesc->info);
+		if (!atomic_sub_return(&rdesc->pending, 1))
+			tlb_wake(rscratch);
+	}
+}
+
 static void tlb_process(struct sbi_scratch *scratch)
 {
+	tlb_full_process(scratch);
 	while (tlb_process_once(scratch));
 }
 
+static bool tlb_has_work(struct sbi_scratch *scratch)
+{
+	u32 i;
+	struct sbi_mpsc *tlb_fifo =
+			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
+	struct sbi_hartmask *pending =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_pending_off);
+	struct tlb_full_pending *full =
+			sbi_scratch_offset_ptr(scratch, tlb_full_off);
+
+	if (!sbi_mpsc_is_empty(tlb_fifo))
+		return true;
+
+	for (i = 0; i < array_size(pending->summary); i++) {
+		if (__atomic_load_n(&pending->summary[i], __ATOMIC_RELAXED) ||
+		    __atomic_load_n(&full->senders.summary[i], __ATOMIC_RELAXED))
+			return true;
+	}
+
+	return false;
+}
+
+void sbi_tlb_process_pending(struct sbi_scratch *scratch)
+{
+	/* IPIs may be sent before sbi_tlb_init() */
+	if (!tlb_full_off || !tlb_has_work(scratch))
+		return;
+
+	tlb_bcast_process(scratch);
+	tlb_process(scratch);
+}
+
+/*
+ * Wait for the remote harts to complete our requests. Requests from
+ * other harts, and IPIs they forward through us as cluster leader, are
+ * served while waiting so that two harts fencing each other can not
+ * deadlock.
+ *
+ * Instead of spinning, the hart stalls with Zawrs WRS.NTO on the counter
+ * when available, or in WFI until the last remote hart sends a completion
+ * IPI. In both cases, a new request IPI also ends the stall.
+ */
+static void tlb_wait(struct sbi_scratch *scratch, atomic_t *counter)
+{
+	bool deferred = false;
+	bool zawrs = sbi_hart_has_extension(scratch, SBI_HART_EXT_ZAWRS);
+	unsigned long *waiting = sbi_scratch_offset_ptr(scratch, tlb_wait_off);
+
+	while (atomic_read(counter) > 0) {
+		tlb_full_process(scratch);
+		tlb_bcast_process(scratch);
+		if (tlb_process_once(scratch) ||
+		    sbi_ipi_process_forwards(scratch))
+			continue;
+
+		/*
+		 * Service a pending TLB IPI first, otherwise WRS.NTO and WFI
+		 * would return right away. Other events (such as HALT) must
+		 * not run in the middle of the ecall so they stay pending
+		 * with the IPI raised, and we just poll from then on. IPIs
+		 * which are not visible in MIP.MSIP (such as IMSIC) also end
+		 * the stall right away so we also just poll.
+		 */
+		if (deferred) {
+			cpu_relax();
+			continue;
+		}
+		if (csr_read(CSR_MIP) & MIP_MSIP) {
+			deferred = sbi_ipi_process_events(BIT(tlb_event) |
+							  BIT(tlb_bcast_event));
+			continue;
+		}
+
+		if (zawrs) {
+			if ((long)tlb_load_reserved(
+					(volatile unsigned long *)&counter->counter) > 0 &&
+			    !tlb_has_work(scratch))
+				wrs_nto();
+			continue;
+		}
+
+		__atomic_store_n(waiting, 1, __ATOMIC_RELAXED);
+		/* Pairs with the smp_mb() in tlb_wake() */
+		smp_mb();
+		if (atomic_read(counter) > 0 && !tlb_has_work(scratch))
+			wfi();
+		__atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+	}
+}
+
+static void tlb_wait_timed(struct sbi_scratch *scratch, atomic_t *counter)
+{
+	struct tlb_stats_state *st = tlb_stats_ptr(scratch);
+	unsigned long cycles = tlb_stats_cycles();
+
+	tlb_wait(scratch, counter);
+
+	if (st)
+		tlb_stats_add(scratch, SBI_TLB_STAT_SYNC, st->req_type,
+			      tlb_stats_cycles() - cycles);
+}
+
 static void tlb_sync(struct sbi_scratch *scratch)
 {
 	atomic_t *tlb_sync =
 			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 
-	while (atomic_read(tlb_sync) > 0) {
-		/*
-		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
-		 */
+	tlb_wait_timed(scratch, tlb_sync);
+}
+
+static void tlb_bcast_sync(struct sbi_scratch *scratch)
+{
+	struct tlb_bcast_desc *desc =
+			sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+
+	tlb_wait_timed(scratch, &desc->pending);
+}
+
+/*
+ * Wait, for a bounded time, until the remote fifo has a free slot while
+ * serving our own requests. Zawrs WRS.STO on the remote fifo head stalls
+ * until the remote hart dequeues an entry.
+ */
+static void tlb_fifo_full_wait(struct sbi_scratch *scratch,
+			       struct sbi_mpsc *tlb_fifo_r)
+{
+	bool zawrs = sbi_hart_has_extension(scratch, SBI_HART_EXT_ZAWRS);
+	unsigned long head;
+	u32 i;
+
+	for (i = 0; i < TLB_FIFO_FULL_WAIT_LOOPS; i++) {
+		tlb_full_process(scratch);
+		tlb_bcast_process(scratch);
 		tlb_process_once(scratch);
+
+		if (sbi_mpsc_avail(tlb_fifo_r) < tlb_fifo_r->num_entries)
+			return;
+
+		if (zawrs) {
+			head = tlb_load_reserved(&tlb_fifo_r->head);
+			if (tlb_fifo_r->tail - head >= tlb_fifo_r->num_entries)
+				wrs_sto();
+		} else {
+			cpu_relax();
+		}
+	}
+}
+
+/*
+ * Add the source harts of next to curr. Returns false and leaves curr
+ * unchanged if the union does not fit in one request.
+ */
+static bool tlb_src_merge(struct sbi_tlb_info *curr,
+			  const struct sbi_tlb_info *next)
+{
+	u16 src[SBI_TLB_INFO_MAX_SRC];
+	u32 i, j, free = 0;
+
+	sbi_memcpy(src, curr->src, sizeof(src));
+	for (i = 0; i < SBI_TLB_INFO_MAX_SRC; i++) {
+		if (next->src[i] == SBI_TLB_INFO_NO_SRC)
+			continue;
+		for (j = 0; j < SBI_TLB_INFO_MAX_SRC; j++) {
+			if (src[j] == next->src[i])
+				break;
+		}
+		if (j < SBI_TLB_INFO_MAX_SRC)
+			continue;
+		while (free < SBI_TLB_INFO_MAX_SRC &&
+		       src[free] != SBI_TLB_INFO_NO_SRC)
+			free++;
+		if (free == SBI_TLB_INFO_MAX_SRC)
+			return false;
+		src[free] = next->src[i];
 	}
 
-	return;
+	sbi_memcpy(curr->src, src, sizeof(src));
+	return true;
 }
 
 static inline int tlb_range_check(struct sbi_tlb_info *curr,
@@ -274,12 +1145,14 @@ static inline int tlb_range_check(struct sbi_tlb_info *curr,
 	next_end = next->start + next->size;
 	curr_end = curr->start + curr->size;
 	if (next->start <= curr->start && next_end > curr_end) {
+		if (!tlb_src_merge(curr, next))
+			return ret;
 		curr->start = next->start;
 		curr->size  = next->size;
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
 		ret = SBI_FIFO_UPDATED;
 	} else if (next->start >= curr->start && next_end <= curr_end) {
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+		if (!tlb_src_merge(curr, next))
+			return ret;
 		ret = SBI_FIFO_SKIP;
 	}
 
@@ -297,12 +1170,14 @@ static inline int tlb_range_check(struct sbi_tlb_info *curr,
  *	if flush request range in current fifo entry lies within next flush
  *	request, update the current entry.
  *
+ * Both cases only apply to entries of the same type which also match the
+ * ASID and/or VMID used by that type.
+ *
  * Note:
  *	We can not issue a fifo reset anymore if a complete vma flush is requested.
  *	This is because we are queueing FENCE.I requests as well now.
- *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
- *	before continuing the while loop. This method is preferred over wfi/ipi because
- *	of MMIO cost involved in later method.
+ *	To ease up the pressure in enqueue/fifo sync path, keep dequeuing our own
+ *	fifo while waiting for a slot of the remote fifo in tlb_fifo_full_wait().
  */
 static int tlb_update_cb(void *in, void *data)
 {
@@ -316,25 +1191,91 @@ static int tlb_update_cb(void *in, void *data)
 	curr = (struct sbi_tlb_info *)data;
 	next = (struct sbi_tlb_info *)in;
 
-	if (next->type == SBI_TLB_SFENCE_VMA_ASID &&
-	    curr->type == SBI_TLB_SFENCE_VMA_ASID) {
+	if (next->type != curr->type)
+		return ret;
+
+	switch (next->type) {
+	case SBI_TLB_SFENCE_VMA:
+	case SBI_TLB_HFENCE_GVMA:
+		ret = tlb_range_check(curr, next);
+		break;
+	case SBI_TLB_SFENCE_VMA_ASID:
 		if (next->asid == curr->asid)
 			ret = tlb_range_check(curr, next);
-	} else if (next->type == SBI_TLB_SFENCE_VMA &&
-		   curr->type == SBI_TLB_SFENCE_VMA) {
-		ret = tlb_range_check(curr, next);
+		break;
+	case SBI_TLB_HFENCE_GVMA_VMID:
+	case SBI_TLB_HFENCE_VVMA:
+		if (next->vmid == curr->vmid)
+			ret = tlb_range_check(curr, next);
+		break;
+	case SBI_TLB_HFENCE_VVMA_ASID:
+		if (next->vmid == curr->vmid && next->asid == curr->asid)
+			ret = tlb_range_check(curr, next);
+		break;
+	default:
+		break;
 	}
 
 	return ret;
 }
 
+/**
+ * Call back used instead of tlb_update_cb() when the remote fifo is above
+ * its high-water mark.
+ *
+ * Case3:
+ *	if next and current fifo entries are VMID scoped requests of the
+ *	same class for the same VMID, promote the current entry to a flush
+ *	of the whole VMID and skip the next entry.
+ */
+static int tlb_update_promote_cb(void *in, void *data)
+{
+	struct sbi_tlb_info *curr;
+	struct sbi_tlb_info *next;
+	int ret;
+
+	ret = tlb_update_cb(in, data);
+	if (ret != SBI_FIFO_UNCHANGED)
+		return ret;
+
+	curr = (struct sbi_tlb_info *)data;
+	next = (struct sbi_tlb_info *)in;
+
+	if (next->vmid != curr->vmid)
+		return ret;
+
+	if (next->type == SBI_TLB_HFENCE_GVMA_VMID &&
+	    curr->type == SBI_TLB_HFENCE_GVMA_VMID) {
+		if (!tlb_src_merge(curr, next))
+			return ret;
+		curr->start = 0;
+		curr->size = SBI_TLB_FLUSH_ALL;
+	} else if ((next->type == SBI_TLB_HFENCE_VVMA ||
+		    next->type == SBI_TLB_HFENCE_VVMA_ASID) &&
+		   (curr->type == SBI_TLB_HFENCE_VVMA ||
+		    curr->type == SBI_TLB_HFENCE_VVMA_ASID)) {
+		if (!tlb_src_merge(curr, next))
+			return ret;
+		curr->type = SBI_TLB_HFENCE_VVMA;
+		curr->asid = 0;
+		curr->start = 0;
+		curr->size = SBI_TLB_FLUSH_ALL;
+	} else {
+		return ret;
+	}
+
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_VMID_PROMOTED);
+
+	return SBI_FIFO_UPDATED;
+}
+
 static int tlb_update(struct sbi_scratch *scratch,
 			  struct sbi_scratch *remote_scratch,
 			  u32 remote_hartindex, void *data)
 {
 	int ret;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_fifo_r;
+	struct sbi_mpsc *tlb_fifo_r;
 	struct sbi_tlb_info *tinfo = data;
 	u32 curr_hartid = current_hartid();
 
@@ -347,23 +1288,43 @@ static int tlb_update(struct sbi_scratch *scratch,
 		return SBI_IPI_UPDATE_BREAK;
 	}
 
+	if (tlb_resid_skip(remote_scratch, tinfo)) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_RFENCE_SKIPPED);
+		return SBI_IPI_UPDATE_BREAK;
+	}
+
 	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
 
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, tlb_update_cb);
+	if (sbi_mpsc_avail(tlb_fifo_r) >=
+	    TLB_FIFO_HIGH_WATERMARK(tlb_fifo_r->num_entries))
+		ret = sbi_mpsc_inplace_update(tlb_fifo_r, data,
+					      tlb_update_promote_cb);
+	else
+		ret = sbi_mpsc_inplace_update(tlb_fifo_r, data, tlb_update_cb);
+
+	if (ret != SBI_FIFO_UNCHANGED) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_RFENCE_MERGED);
+		if (tinfo->type >= SBI_TLB_HFENCE_GVMA_VMID)
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_MERGED);
+	}
 
 	if (ret == SBI_FIFO_UNCHANGED &&
-	    sbi_fifo_enqueue(tlb_fifo_r, data, false) < 0) {
+	    sbi_mpsc_enqueue(tlb_fifo_r, data) < 0) {
+		/*
+		 * Fold the request into the full flush pending state of
+		 * the target hart so that we never wait for fifo space.
+		 */
+		if (tlb_full_fold(scratch, remote_scratch, tinfo)) {
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_RFENCE_FOLDED);
+			return SBI_IPI_UPDATE_SUCCESS;
+		}
+
 		/**
-		 * For now, Busy loop until there is space in the fifo.
-		 * There may be case where target hart is also
-		 * enqueue in source hart's fifo. Both hart may busy
-		 * loop leading to a deadlock.
-		 * TODO: Introduce a wait/wakeup event mechanism to handle
-		 * this properly.
+		 * Otherwise, wait for space in the fifo and retry. The
+		 * target hart may also be enqueueing in the source hart's
+		 * fifo, so tlb_fifo_full_wait() keeps serving our own fifo.
 		 */
-		tlb_process_once(scratch);
-		sbi_dprintf("hart%d: hart%d tlb fifo full\n", curr_hartid,
-			    sbi_hartindex_to_hartid(remote_hartindex));
+		tlb_fifo_full_wait(scratch, tlb_fifo_r);
 		return SBI_IPI_UPDATE_RETRY;
 	}
 
@@ -380,7 +1341,52 @@ static struct sbi_ipi_event_ops tlb_ops = {
 	.process = tlb_process,
 };
 
-static u32 tlb_event = SBI_IPI_EVENT_MAX;
+static int tlb_bcast_update(struct sbi_scratch *scratch,
+			    struct sbi_scratch *remote_scratch,
+			    u32 remote_hartindex, void *data)
+{
+	struct tlb_bcast_desc *desc = data;
+	struct sbi_hartmask *rpending;
+
+	if (remote_scratch == scratch) {
+		tlb_entry_local_process(&desc->info);
+		return SBI_IPI_UPDATE_BREAK;
+	}
+
+	if (tlb_resid_skip(remote_scratch, &desc->info)) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_RFENCE_SKIPPED);
+		return SBI_IPI_UPDATE_BREAK;
+	}
+
+	atomic_add_return(&desc->pending, 1);
+	rpending = sbi_scratch_offset_ptr(remote_scratch, tlb_bcast_pending_off);
+	sbi_hartmask_atomic_set_hartindex(scratch->hartindex, rpending);
+
+	return SBI_IPI_UPDATE_SUCCESS;
+}
+
+static struct sbi_ipi_event_ops tlb_bcast_ops = {
+	.name = "IPI_TLB_BCAST",
+	.update = tlb_bcast_update,
+	.sync = tlb_bcast_sync,
+	.process = tlb_bcast_process,
+	.forward = true,
+};
+
+static bool tlb_bcast_wanted(ulong hmask, ulong hbase)
+{
+	ulong count;
+
+	if (!TLB_BCAST_MIN_HARTS)
+		return false;
+
+	if (hbase == -1UL)
+		count = sbi_scratch_last_hartindex() + 1;
+	else
+		count = sbi_popcount(hmask);
+
+	return count >= TLB_BCAST_MIN_HARTS;
+}
 
 static const u32 tlb_type_to_pmu_fw_event[SBI_TLB_TYPE_MAX] = {
 	[SBI_TLB_FENCE_I] = SBI_PMU_FW_FENCE_I_SENT,
@@ -394,13 +1400,24 @@ static const u32 tlb_type_to_pmu_fw_event[SBI_TLB_TYPE_MAX] = {
 
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 {
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct tlb_stats_state *st = tlb_stats_ptr(scratch);
+	unsigned long cycles = tlb_stats_cycles();
+	int ret;
+
 	if (tinfo->type < 0 || tinfo->type >= SBI_TLB_TYPE_MAX)
 		return SBI_EINVAL;
 
+	if (st) {
+		st->req_type = tinfo->type;
+		st->req_time = sbi_timer_value();
+	}
+
 	/*
 	 * If address range to flush is too big then simply
 	 * upgrade it to flush all because we can only flush
-	 * 4KB at a time.
+	 * 4KB at a time. With a calibrated limit, the upgrade
+	 * is done by each receiving hart using its own limit.
 	 */
 	if (tinfo->size > tlb_range_flush_limit) {
 		tinfo->start = 0;
@@ -409,15 +1426,39 @@ int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 
 	sbi_pmu_ctr_incr_fw(tlb_type_to_pmu_fw_event[tinfo->type]);
 
-	return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
+	if (tlb_bcast_wanted(hmask, hbase)) {
+		struct tlb_bcast_desc *desc =
+			sbi_scratch_thishart_offset_ptr(tlb_bcast_off);
+
+		/*
+		 * Publish the request once for all target harts. The
+		 * descriptor is not reused before tlb_bcast_sync() has
+		 * seen every target hart complete it.
+		 */
+		desc->info = *tinfo;
+		smp_wmb();
+
+		ret = sbi_ipi_send_many(hmask, hbase, tlb_bcast_event, desc);
+	} else {
+		ret = sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
+	}
+
+	if (st)
+		tlb_stats_add(scratch, SBI_TLB_STAT_TOTAL, tinfo->type,
+			      tlb_stats_cycles() - cycles);
+
+	return ret;
 }
 
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
-	int ret;
+	int i, ret;
 	void *tlb_mem;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_q;
+	struct sbi_mpsc *tlb_q;
+	struct tlb_bcast_desc *bcast_desc;
+	struct tlb_flush_limit *flush_limit;
+	struct sbi_hartmask *bcast_pending;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
@@ -435,21 +1476,77 @@ int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
+		tlb_bcast_off = sbi_scratch_alloc_offset(sizeof(*bcast_desc));
+		tlb_bcast_pending_off = sbi_scratch_alloc_offset(
+						sizeof(*bcast_pending));
+		tlb_limit_off = sbi_scratch_alloc_offset(sizeof(*flush_limit));
+		tlb_wait_off = sbi_scratch_alloc_offset(sizeof(unsigned long));
+		tlb_resid_off = sbi_scratch_alloc_offset(
+					sizeof(struct tlb_residency));
+		tlb_full_off = sbi_scratch_alloc_offset(
+					sizeof(struct tlb_full_pending));
+		tlb_stats_off = sbi_scratch_alloc_offset(sizeof(void *));
+		if (!tlb_bcast_off || !tlb_bcast_pending_off ||
+		    !tlb_limit_off || !tlb_wait_off || !tlb_resid_off ||
+		    !tlb_full_off || !tlb_stats_off) {
+			sbi_scratch_free_offset(tlb_stats_off);
+			sbi_scratch_free_offset(tlb_full_off);
+			sbi_scratch_free_offset(tlb_resid_off);
+			sbi_scratch_free_offset(tlb_wait_off);
+			sbi_scratch_free_offset(tlb_limit_off);
+			sbi_scratch_free_offset(tlb_bcast_pending_off);
+			sbi_scratch_free_offset(tlb_bcast_off);
+			sbi_scratch_free_offset(tlb_fifo_mem_off);
+			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_sync_off);
+			return SBI_ENOMEM;
+		}
 		ret = sbi_ipi_event_create(&tlb_ops);
 		if (ret < 0) {
+			sbi_scratch_free_offset(tlb_stats_off);
+			sbi_scratch_free_offset(tlb_full_off);
+			sbi_scratch_free_offset(tlb_resid_off);
+			sbi_scratch_free_offset(tlb_wait_off);
+			sbi_scratch_free_offset(tlb_limit_off);
+			sbi_scratch_free_offset(tlb_bcast_pending_off);
+			sbi_scratch_free_offset(tlb_bcast_off);
 			sbi_scratch_free_offset(tlb_fifo_mem_off);
 			sbi_scratch_free_offset(tlb_fifo_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return ret;
 		}
 		tlb_event = ret;
+		ret = sbi_ipi_event_create(&tlb_bcast_ops);
+		if (ret < 0) {
+			sbi_ipi_event_destroy(tlb_event);
+			sbi_scratch_free_offset(tlb_stats_off);
+			sbi_scratch_free_offset(tlb_full_off);
+			sbi_scratch_free_offset(tlb_resid_off);
+			sbi_scratch_free_offset(tlb_wait_off);
+			sbi_scratch_free_offset(tlb_limit_off);
+			sbi_scratch_free_offset(tlb_bcast_pending_off);
+			sbi_scratch_free_offset(tlb_bcast_off);
+			sbi_scratch_free_offset(tlb_fifo_mem_off);
+			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_sync_off);
+			return ret;
+		}
+		tlb_bcast_event = ret;
 		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
 	} else {
 		if (!tlb_sync_off ||
 		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_fifo_mem_off ||
+		    !tlb_bcast_off ||
+		    !tlb_bcast_pending_off ||
+		    !tlb_limit_off ||
+		    !tlb_wait_off ||
+		    !tlb_resid_off ||
+		    !tlb_full_off ||
+		    !tlb_stats_off)
 			return SBI_ENOMEM;
-		if (SBI_IPI_EVENT_MAX <= tlb_event)
+		if (SBI_IPI_EVENT_MAX <= tlb_event ||
+		    SBI_IPI_EVENT_MAX <= tlb_bcast_event)
 			return SBI_ENOSPC;
 	}
 
@@ -458,16 +1555,49 @@ int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 	tlb_mem = sbi_scratch_read_type(scratch, void *, tlb_fifo_mem_off);
 	if (!tlb_mem) {
 		tlb_mem = sbi_malloc(
-				sbi_platform_tlb_fifo_num_entries(plat) * SBI_TLB_INFO_SIZE);
+				SBI_MPSC_MEM_SIZE(sbi_platform_tlb_fifo_num_entries(plat),
+						  SBI_TLB_INFO_SIZE));
 		if (!tlb_mem)
 			return SBI_ENOMEM;
 		sbi_scratch_write_type(scratch, void *, tlb_fifo_mem_off, tlb_mem);
 	}
 
-	ATOMIC_INIT(tlb_sync, 0);
+	if (TLB_STATS && !tlb_stats_ptr(scratch)) {
+		struct tlb_stats_state *st = sbi_zalloc(sizeof(*st));
 
-	sbi_fifo_init(tlb_q, tlb_mem,
+		if (!st)
+			return SBI_ENOMEM;
+		sbi_scratch_write_type(scratch, void *, tlb_stats_off, st);
+	}
+
+	ATOMIC_INIT(tlb_sync, 0);
+	sbi_scratch_write_type(scratch, unsigned long, tlb_wait_off, 0);
+	sbi_memset(sbi_scratch_offset_ptr(scratch, tlb_resid_off), 0,
+		   sizeof(struct tlb_residency));
+	sbi_memset(sbi_scratch_offset_ptr(scratch, tlb_full_off), 0,
+		   sizeof(struct tlb_full_pending));
+
+	bcast_desc = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+	ATOMIC_INIT(&bcast_desc->pending, 0);
+	bcast_pending = sbi_scratch_offset_ptr(scratch, tlb_bcast_pending_off);
+	sbi_memset(bcast_pending, 0, sizeof(*bcast_pending));
+
+	sbi_mpsc_init(tlb_q, tlb_mem,
 		      sbi_platform_tlb_fifo_num_entries(plat), SBI_TLB_INFO_SIZE);
 
+	flush_limit = sbi_scratch_offset_ptr(scratch, tlb_limit_off);
+	if (!flush_limit->calibrated) {
+		if (tlb_range_flush_limit == SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_AUTO) {
+			tlb_calibrate_limits(flush_limit);
+		} else {
+			/* Platform limits beyond XLEN never upgrade a range */
+			for (i = 0; i < SBI_TLB_TYPE_MAX; i++)
+				flush_limit->limit[i] =
+					(tlb_range_flush_limit < -1UL) ?
+					tlb_range_flush_limit : -1UL;
+		}
+		flush_limit->calibrated = true;
+	}
+
 	return 0;
 }
@@ -14,6 +14,7 @@
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
+#include <sbi/sbi_heap.h>
 #include <sbi/sbi_illegal_insn.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_irqchip.h>
@@ -21,9 +22,143 @@
 #include <sbi/sbi_pmu.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_sse.h>
+#include <sbi/sbi_string.h>
 #include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 
+#ifdef CONFIG_SBI_TRAP_TRACE
+#define TRAP_TRACE		true
+#define TRAP_TRACE_ENTRIES	CONFIG_SBI_TRAP_TRACE_ENTRIES
+#else
+#define TRAP_TRACE		false
+#define TRAP_TRACE_ENTRIES	1
+#endif
+
+/*
+ * Per-hart trap trace ring allocated from the heap. Only the owner hart
+ * records and reads it. The free running head is the next record written
+ * and tail is the oldest record not yet drained. Records older than one
+ * ring length are overwritten.
+ */
+struct trap_trace {
+	unsigned long head;
+	unsigned long tail;
+	struct sbi_trap_trace_entry entries[TRAP_TRACE_ENTRIES];
+};
+
+static unsigned long trap_trace_off;
+
+static inline struct trap_trace *trap_trace_ptr(struct sbi_scratch *scratch)
+{
+	if (!TRAP_TRACE || !trap_trace_off)
+		return NULL;
+
+	return sbi_scratch_read_type(scratch, void *, trap_trace_off);
+}
+
+static inline u64 trap_trace_cycles(void)
+{
+	return TRAP_TRACE ? csr_read(CSR_MCYCLE) : 0;
+}
+
+static void trap_trace_record(struct sbi_scratch *scratch, ulong mcause,
+			      ulong extid, ulong funcid, u64 entry_cycle)
+{
+	struct trap_trace *tt = trap_trace_ptr(scratch);
+	struct sbi_trap_trace_entry *e;
+
+	if (!tt)
+		return;
+
+	e = &tt->entries[tt->head % TRAP_TRACE_ENTRIES];
+	e->cause = mcause;
+	e->extid = extid;
+	e->funcid = funcid;
+	e->entry_cycle = entry_cycle;
+	e->exit_cycle = trap_trace_cycles();
+	tt->head++;
+}
+
+int sbi_trap_trace_read(struct sbi_trap_trace_entry *out,
+			unsigned long num_entries, unsigned long flags)
+{
+	struct trap_trace *tt = trap_trace_ptr(sbi_scratch_thishart_ptr());
+	unsigned long i, count;
+
+	if (!tt)
+		return SBI_ENOTSUPP;
+
+	/* Skip the records which have been overwritten */
+	if (TRAP_TRACE_ENTRIES < tt->head - tt->tail)
+		tt->tail = tt->head - TRAP_TRACE_ENTRIES;
+
+	count = tt->head - tt->tail;
+	if (num_entries < count)
+		count = num_entries;
+
+	for (i = 0; i < count; i++)
+		sbi_memcpy(&out[i],
+			   &tt->entries[(tt->tail + i) % TRAP_TRACE_ENTRIES],
+			   sizeof(*out));
+
+	if (flags & SBI_TRAP_TRACE_READ_DRAIN)
+		tt->tail += count;
+
+	return count;
+}
+
+int sbi_trap_trace_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct trap_trace *tt;
+
+	if (!TRAP_TRACE)
+		return 0;
+
+	if (cold_boot) {
+		trap_trace_off = sbi_scratch_alloc_offset(sizeof(void *));
+		if (!trap_trace_off)
+			return SBI_ENOMEM;
+	} else if (!trap_trace_off) {
+		return SBI_ENOMEM;
+	}
+
+	tt = trap_trace_ptr(scratch);
+	if (!tt) {
+		tt = sbi_zalloc(sizeof(*tt));
+		if (!tt)
+			return SBI_ENOMEM;
+		sbi_scratch_write_type(scratch, void *, trap_trace_off, tt);
+	}
+
+	tt->head = tt->tail = 0;
+
+	return 0;
+}
+
+/*
+ * Per-hart trap dispatch state, filled in once the features of the hart
+ * are known so that the trap paths do not have to check them again.
+ */
+struct trap_hart_dispatch {
+	/* Local interrupt dispatcher, AIA or non-AIA */
+	int (*irq)(unsigned long irq);
+	/* Hart has the H extension */
+	bool hext;
+	/* Hart has the Zicfilp extension */
+	bool zicfilp;
+};
+
+static unsigned long trap_dispatch_off;
+
+static inline const struct trap_hart_dispatch *
+trap_dispatch_ptr(struct sbi_scratch *scratch)
+{
+	if (unlikely(!trap_dispatch_off))
+		return NULL;
+
+	return sbi_scratch_offset_ptr(scratch, trap_dispatch_off);
+}
+
 static void sbi_trap_error_one(const struct sbi_trap_context *tcntx,
 			       const char *prefix, u32 hartid, u32 depth)
 {
@@ -107,14 +242,20 @@ int sbi_trap_redirect(struct sbi_trap_regs *regs,
 	bool prev_virt = sbi_regs_from_virt(regs);
 	/* By default, we redirect to HS-mode */
 	bool next_virt = false;
+	const struct trap_hart_dispatch *thd =
+			trap_dispatch_ptr(sbi_scratch_thishart_ptr());
 
 	/* Sanity check on previous mode */
 	prev_mode = sbi_mstatus_prev_mode(regs->mstatus);
 	if (prev_mode != PRV_S && prev_mode != PRV_U)
 		return SBI_ENOTSUPP;
 
+	/* Lower modes only run once the hart is initialized */
+	if (!thd)
+		return SBI_ENOTSUPP;
+
 	/* If hart support for zicfilp, clear MPELP because redirecting to VS or (H)S */
-	if (sbi_hart_has_extension(sbi_scratch_thishart_ptr(), SBI_HART_EXT_ZICFILP)) {
+	if (thd->zicfilp) {
 #if __riscv_xlen == 32
 		elp = regs->mstatusH & MSTATUSH_MPELP;
 		regs->mstatusH &= ~MSTATUSH_MPELP;
@@ -127,7 +268,7 @@ int sbi_trap_redirect(struct sbi_trap_regs *regs,
 	/* If exceptions came from VS/VU-mode, redirect to VS-mode if
 	 * delegated in hedeleg
 	 */
-	if (misa_extension('H') && prev_virt) {
+	if (thd->hext && prev_virt) {
 		if ((trap->cause < __riscv_xlen) &&
 		    (csr_read(CSR_HEDELEG) & BIT(trap->cause))) {
 			next_virt = true;
@@ -144,7 +285,7 @@ int sbi_trap_redirect(struct sbi_trap_regs *regs,
 #endif
 
 	/* Update hypervisor CSRs if going to HS-mode */
-	if (misa_extension('H') && !next_virt) {
+	if (thd->hext && !next_virt) {
 		hstatus = csr_read(CSR_HSTATUS);
 		if (prev_virt) {
 			/* hstatus.SPVP is only updated if coming from VS/VU-mode */
@@ -230,57 +371,163 @@ int sbi_trap_redirect(struct sbi_trap_regs *regs,
 	return 0;
 }
 
-static int sbi_trap_nonaia_irq(unsigned long irq)
+static int sbi_trap_misaligned_load(struct sbi_trap_context *tcntx)
 {
-	switch (irq) {
-	case IRQ_M_TIMER:
-		sbi_timer_process();
-		break;
-	case IRQ_M_SOFT:
-		sbi_ipi_process();
-		break;
-	case IRQ_PMU_OVF:
-		sbi_pmu_ovf_irq();
-		break;
-	case IRQ_M_EXT:
-		return sbi_irqchip_process();
-	default:
-		return SBI_ENOENT;
-	}
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_MISALIGNED_LOAD);
+	return sbi_misaligned_load_handler(tcntx);
+}
+
+static int sbi_trap_misaligned_store(struct sbi_trap_context *tcntx)
+{
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_MISALIGNED_STORE);
+	return sbi_misaligned_store_handler(tcntx);
+}
+
+static int sbi_trap_load_access(struct sbi_trap_context *tcntx)
+{
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_ACCESS_LOAD);
+	return sbi_load_access_handler(tcntx);
+}
+
+static int sbi_trap_store_access(struct sbi_trap_context *tcntx)
+{
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_ACCESS_STORE);
+	return sbi_store_access_handler(tcntx);
+}
+
+/*
+ * Exception handlers indexed by cause. Exceptions without a handler are
+ * redirected to S-mode or U-mode.
+ */
+static sbi_trap_exception_handler_t trap_exc_handlers[SBI_TRAP_CAUSE_MAX] = {
+	[CAUSE_ILLEGAL_INSTRUCTION]	= sbi_illegal_insn_handler,
+	[CAUSE_MISALIGNED_LOAD]		= sbi_trap_misaligned_load,
+	[CAUSE_MISALIGNED_STORE]	= sbi_trap_misaligned_store,
+	[CAUSE_SUPERVISOR_ECALL]	= sbi_ecall_handler,
+	[CAUSE_MACHINE_ECALL]		= sbi_ecall_handler,
+	[CAUSE_LOAD_ACCESS]		= sbi_trap_load_access,
+	[CAUSE_STORE_ACCESS]		= sbi_trap_store_access,
+	[CAUSE_DOUBLE_TRAP]		= sbi_double_trap_handler,
+};
+
+static const char *trap_exc_msgs[SBI_TRAP_CAUSE_MAX] = {
+	[CAUSE_ILLEGAL_INSTRUCTION]	= "illegal instruction handler failed",
+	[CAUSE_MISALIGNED_LOAD]		= "misaligned load handler failed",
+	[CAUSE_MISALIGNED_STORE]	= "misaligned store handler failed",
+	[CAUSE_SUPERVISOR_ECALL]	= "ecall handler failed",
+	[CAUSE_MACHINE_ECALL]		= "ecall handler failed",
+	[CAUSE_LOAD_ACCESS]		= "load fault handler failed",
+	[CAUSE_STORE_ACCESS]		= "store fault handler failed",
+	[CAUSE_DOUBLE_TRAP]		= "double trap handler failed",
+};
+
+static int sbi_trap_timer_irq(void)
+{
+	sbi_timer_process();
+	return 0;
+}
+
+static int sbi_trap_soft_irq(void)
+{
+	sbi_ipi_process();
+	return 0;
+}
+
+static int sbi_trap_pmu_ovf_irq(void)
+{
+	sbi_pmu_ovf_irq();
+	return 0;
+}
+
+/* Local interrupt handlers indexed by interrupt number */
+static sbi_trap_irq_handler_t trap_irq_handlers[SBI_TRAP_CAUSE_MAX] = {
+	[IRQ_M_TIMER]	= sbi_trap_timer_irq,
+	[IRQ_M_SOFT]	= sbi_trap_soft_irq,
+	[IRQ_PMU_OVF]	= sbi_trap_pmu_ovf_irq,
+	[IRQ_M_EXT]	= sbi_irqchip_process,
+};
+
+int sbi_trap_set_exception_handler(unsigned long cause,
+				   sbi_trap_exception_handler_t handler)
+{
+	if (SBI_TRAP_CAUSE_MAX <= cause)
+		return SBI_EINVAL;
+
+	trap_exc_handlers[cause] = handler;
+	trap_exc_msgs[cause] = "platform exception handler failed";
+
+	return 0;
+}
+
+int sbi_trap_set_irq_handler(unsigned long irq, sbi_trap_irq_handler_t handler)
+{
+	if (SBI_TRAP_CAUSE_MAX <= irq)
+		return SBI_EINVAL;
+
+	trap_irq_handlers[irq] = handler;
 
 	return 0;
 }
 
-static int sbi_trap_aia_irq(void)
+static inline int sbi_trap_irq_one(unsigned long irq)
+{
+	sbi_trap_irq_handler_t handler;
+
+	if (SBI_TRAP_CAUSE_MAX <= irq)
+		return SBI_ENOENT;
+
+	handler = trap_irq_handlers[irq];
+	if (!handler)
+		return SBI_ENOENT;
+
+	return handler();
+}
+
+static int sbi_trap_nonaia_irq(unsigned long irq)
+{
+	return sbi_trap_irq_one(irq);
+}
+
+static int sbi_trap_aia_irq(unsigned long irq)
 {
 	int rc;
 	unsigned long mtopi;
 
 	while ((mtopi = csr_read(CSR_MTOPI))) {
-		mtopi = mtopi >> TOPI_IID_SHIFT;
-		switch (mtopi) {
-		case IRQ_M_TIMER:
-			sbi_timer_process();
-			break;
-		case IRQ_M_SOFT:
-			sbi_ipi_process();
-			break;
-		case IRQ_PMU_OVF:
-			sbi_pmu_ovf_irq();
-			break;
-		case IRQ_M_EXT:
-			rc = sbi_irqchip_process();
-			if (rc)
-				return rc;
-			break;
-		default:
-			return SBI_ENOENT;
-		}
+		rc = sbi_trap_irq_one(mtopi >> TOPI_IID_SHIFT);
+		if (rc)
+			return rc;
 	}
 
 	return 0;
 }
 
+int sbi_trap_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct trap_hart_dispatch *thd;
+	int rc;
+
+	if (cold_boot) {
+		trap_dispatch_off = sbi_scratch_alloc_offset(sizeof(*thd));
+		if (!trap_dispatch_off)
+			return SBI_ENOMEM;
+	} else if (!trap_dispatch_off) {
+		return SBI_ENOMEM;
+	}
+
+	rc = sbi_trap_ldst_init(scratch, cold_boot);
+	if (rc)
+		return rc;
+
+	thd = sbi_scratch_offset_ptr(scratch, trap_dispatch_off);
+	thd->irq = sbi_hart_has_extension(scratch, SBI_HART_EXT_SMAIA) ?
+		   sbi_trap_aia_irq : sbi_trap_nonaia_irq;
+	thd->hext = misa_extension('H') ? true : false;
+	thd->zicfilp = sbi_hart_has_extension(scratch, SBI_HART_EXT_ZICFILP);
+
+	return 0;
+}
+
 /**
  * Handle trap/interrupt
  *
@@ -305,60 +552,35 @@ struct sbi_trap_context *sbi_trap_handler(struct sbi_trap_context *tcntx)
 	const struct sbi_trap_info *trap = &tcntx->trap;
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	ulong mcause = tcntx->trap.cause;
+	const struct trap_hart_dispatch *thd;
+	u64 trace_cycle = trap_trace_cycles();
+	ulong trace_extid = 0, trace_funcid = 0;
+
+	if (TRAP_TRACE && (mcause == CAUSE_SUPERVISOR_ECALL ||
+			   mcause == CAUSE_MACHINE_ECALL)) {
+		trace_extid = regs->a7;
+		trace_funcid = regs->a6;
+	}
 
 	/* Update trap context pointer */
 	tcntx->prev_context = sbi_trap_get_context(scratch);
 	sbi_trap_set_context(scratch, tcntx);
 
 	if (mcause & MCAUSE_IRQ_MASK) {
-		if (sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
-					   SBI_HART_EXT_SMAIA))
-			rc = sbi_trap_aia_irq();
-		else
-			rc = sbi_trap_nonaia_irq(mcause & ~MCAUSE_IRQ_MASK);
+		thd = trap_dispatch_ptr(scratch);
+		if (thd)
+			rc = thd->irq(mcause & ~MCAUSE_IRQ_MASK);
 		msg = "unhandled local interrupt";
 		goto trap_done;
 	}
 
-	switch (mcause) {
-	case CAUSE_ILLEGAL_INSTRUCTION:
-		rc  = sbi_illegal_insn_handler(tcntx);
-		msg = "illegal instruction handler failed";
-		break;
-	case CAUSE_MISALIGNED_LOAD:
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_MISALIGNED_LOAD);
-		rc  = sbi_misaligned_load_handler(tcntx);
-		msg = "misaligned load handler failed";
-		break;
-	case CAUSE_MISALIGNED_STORE:
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_MISALIGNED_STORE);
-		rc  = sbi_misaligned_store_handler(tcntx);
-		msg = "misaligned store handler failed";
-		break;
-	case CAUSE_SUPERVISOR_ECALL:
-	case CAUSE_MACHINE_ECALL:
-		rc  = sbi_ecall_handler(tcntx);
-		msg = "ecall handler failed";
-		break;
-	case CAUSE_LOAD_ACCESS:
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_ACCESS_LOAD);
-		rc  = sbi_load_access_handler(tcntx);
-		msg = "load fault handler failed";
-		break;
-	case CAUSE_STORE_ACCESS:
-		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_ACCESS_STORE);
-		rc  = sbi_store_access_handler(tcntx);
-		msg = "store fault handler failed";
-		break;
-	case CAUSE_DOUBLE_TRAP:
-		rc  = sbi_double_trap_handler(tcntx);
-		msg = "double trap handler failed";
-		break;
-	default:
+	if (mcause < SBI_TRAP_CAUSE_MAX && trap_exc_handlers[mcause]) {
+		rc  = trap_exc_handlers[mcause](tcntx);
+		msg = trap_exc_msgs[mcause];
+	} else {
 		/* If the trap came from S or U mode, redirect it there */
 		msg = "trap redirect failed";
 		rc  = sbi_trap_redirect(regs, trap);
-		break;
 	}
 
 trap_done:
@@ -368,6 +590,10 @@ trap_done:
 	if (sbi_mstatus_prev_mode(regs->mstatus) != PRV_M)
 		sbi_sse_process_pending_events(regs);
 
+	if (TRAP_TRACE)
+		trap_trace_record(scratch, mcause, trace_extid, trace_funcid,
+				  trace_cycle);
+
 	sbi_trap_set_context(scratch, tcntx->prev_context);
 	return tcntx;
 }
@@ -10,7 +10,11 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/riscv_fp.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_pmu.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
 #include <sbi/sbi_trap_ldst.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_unpriv.h>
@@ -32,8 +36,16 @@ typedef int (*sbi_trap_ld_emulator)(int rlen, union sbi_ldst_data *out_val,
 typedef int (*sbi_trap_st_emulator)(int wlen, union sbi_ldst_data in_val,
 				    struct sbi_trap_context *tcntx);
 
-static ulong sbi_misaligned_tinst_fixup(ulong orig_tinst, ulong new_tinst,
-					ulong addr_offset)
+/**
+ * Vector load/store emulator callback:
+ *
+ * @return positive=success, 0=success w/o regs modification, or negative error
+ */
+typedef int (*sbi_trap_v_emulator)(const struct sbi_ldst_decode *dec,
+				   struct sbi_trap_context *tcntx);
+
+ulong sbi_misaligned_tinst_fixup(ulong orig_tinst, ulong new_tinst,
+				 ulong addr_offset)
 {
 	if (new_tinst == INSN_PSEUDO_VS_LOAD ||
 	    new_tinst == INSN_PSEUDO_VS_STORE)
@@ -44,34 +56,81 @@ static ulong sbi_misaligned_tinst_fixup(ulong orig_tinst, ulong new_tinst,
 		return orig_tinst | (addr_offset << SH_RS1);
 }
 
-static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
-				 sbi_trap_ld_emulator emu)
+#ifdef CONFIG_SBI_TRAP_LDST_CACHE
+#define LDST_CACHE	true
+#else
+#define LDST_CACHE	false
+#endif
+
+/* Number of decoded instructions cached per hart, must be a power of 2 */
+#define LDST_CACHE_ENTRIES	8
+
+struct ldst_cache_entry {
+	ulong pc;
+	/* Previous mode and access type, zero for an invalid entry */
+	ulong tag;
+	/* Instruction bits the entry was decoded from */
+	ulong insn;
+	struct sbi_ldst_decode dec;
+};
+
+/*
+ * Per-hart cache of decoded instructions. All entries are decoded under
+ * the same satp, so they are dropped whenever satp changes.
+ */
+struct ldst_cache {
+	ulong satp;
+	struct ldst_cache_entry entries[LDST_CACHE_ENTRIES];
+};
+
+static unsigned long ldst_cache_off;
+
+static inline struct ldst_cache *ldst_cache_thishart(void)
 {
-	const struct sbi_trap_info *orig_trap = &tcntx->trap;
-	struct sbi_trap_regs *regs = &tcntx->regs;
-	ulong insn, insn_len;
-	union sbi_ldst_data val = { 0 };
-	struct sbi_trap_info uptrap;
-	int rc, fp = 0, shift = 0, len = 0;
+	if (!LDST_CACHE || !ldst_cache_off)
+		return NULL;
 
-	if (orig_trap->tinst & 0x1) {
-		/*
-		 * Bit[0] == 1 implies trapped instruction value is
-		 * transformed instruction or custom instruction.
-		 */
-		insn	 = orig_trap->tinst | INSN_16BIT_MASK;
-		insn_len = (orig_trap->tinst & 0x2) ? INSN_LEN(insn) : 2;
-	} else {
-		/*
-		 * Bit[0] == 0 implies trapped instruction value is
-		 * zero or special value.
-		 */
-		insn = sbi_get_insn(regs->mepc, &uptrap);
-		if (uptrap.cause) {
-			return sbi_trap_redirect(regs, &uptrap);
-		}
-		insn_len = INSN_LEN(insn);
-	}
+	return sbi_scratch_thishart_offset_ptr(ldst_cache_off);
+}
+
+static inline ulong ldst_cache_tag(const struct sbi_trap_regs *regs,
+				   bool store)
+{
+	return BIT(0) | (sbi_mstatus_prev_mode(regs->mstatus) << 1) |
+	       (store ? BIT(3) : 0);
+}
+
+void sbi_trap_ldst_cache_flush(void)
+{
+	struct ldst_cache *lc = ldst_cache_thishart();
+
+	if (lc)
+		sbi_memset(lc->entries, 0, sizeof(lc->entries));
+}
+
+int sbi_trap_ldst_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct ldst_cache *lc;
+
+	if (!LDST_CACHE)
+		return 0;
+
+	/* Without space for the cache, instructions are always decoded */
+	if (cold_boot)
+		ldst_cache_off = sbi_scratch_alloc_type_offset(struct ldst_cache);
+	if (!ldst_cache_off)
+		return 0;
+
+	lc = sbi_scratch_offset_ptr(scratch, ldst_cache_off);
+	sbi_memset(lc, 0, sizeof(*lc));
+
+	return 0;
+}
+
+static bool sbi_trap_decode_load(ulong insn, struct sbi_ldst_decode *dec)
+{
+	int fp = 0, shift = 0, len = 0, vector = 0;
+	ulong reg = (insn >> SH_RD) & 0x1f;
 
 	if ((insn & INSN_MASK_LB) == INSN_MATCH_LB) {
 		len   = 1;
@@ -105,7 +164,7 @@ static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
 	} else if ((insn & INSN_MASK_C_LD) == INSN_MATCH_C_LD) {
 		len   = 8;
 		shift = 8 * (sizeof(ulong) - len);
-		insn  = RVC_RS2S(insn) << SH_RD;
+		reg   = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_LDSP) == INSN_MATCH_C_LDSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len   = 8;
@@ -114,24 +173,24 @@ static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
 	} else if ((insn & INSN_MASK_C_LW) == INSN_MATCH_C_LW) {
 		len   = 4;
 		shift = 8 * (sizeof(ulong) - len);
-		insn  = RVC_RS2S(insn) << SH_RD;
+		reg   = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_LWSP) == INSN_MATCH_C_LWSP &&
 		   ((insn >> SH_RD) & 0x1f)) {
 		len   = 4;
 		shift = 8 * (sizeof(ulong) - len);
 #ifdef __riscv_flen
 	} else if ((insn & INSN_MASK_C_FLD) == INSN_MATCH_C_FLD) {
-		fp   = 1;
-		len  = 8;
-		insn = RVC_RS2S(insn) << SH_RD;
+		fp  = 1;
+		len = 8;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FLDSP) == INSN_MATCH_C_FLDSP) {
 		fp  = 1;
 		len = 8;
 #if __riscv_xlen == 32
 	} else if ((insn & INSN_MASK_C_FLW) == INSN_MATCH_C_FLW) {
-		fp   = 1;
-		len  = 4;
-		insn = RVC_RS2S(insn) << SH_RD;
+		fp  = 1;
+		len = 4;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FLWSP) == INSN_MATCH_C_FLWSP) {
 		fp  = 1;
 		len = 4;
@@ -139,63 +198,44 @@ static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
 #endif
 	} else if ((insn & INSN_MASK_C_LHU) == INSN_MATCH_C_LHU) {
 		len = 2;
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_LH) == INSN_MATCH_C_LH) {
-		len = 2;
+		len   = 2;
 		shift = 8 * (sizeof(ulong) - len);
-		insn = RVC_RS2S(insn) << SH_RD;
+		reg   = RVC_RS2S(insn);
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	} else if ((insn & INSN_MASK_VLE8) == INSN_MATCH_VLE8) {
+		vector = 1;
+		len    = 1;
+	} else if ((insn & INSN_MASK_VLE16) == INSN_MATCH_VLE16) {
+		vector = 1;
+		len    = 2;
+	} else if ((insn & INSN_MASK_VLE32) == INSN_MATCH_VLE32) {
+		vector = 1;
+		len    = 4;
+	} else if ((insn & INSN_MASK_VLE64) == INSN_MATCH_VLE64) {
+		vector = 1;
+		len    = 8;
+#endif
 	} else {
-		return sbi_trap_redirect(regs, orig_trap);
+		return false;
 	}
 
-	rc = emu(len, &val, tcntx);
-	if (rc <= 0)
-		return rc;
-
-	if (!fp)
-		SET_RD(insn, regs, ((long)(val.data_ulong << shift)) >> shift);
-#ifdef __riscv_flen
-	else if (len == 8)
-		SET_F64_RD(insn, regs, val.data_u64);
-	else
-		SET_F32_RD(insn, regs, val.data_ulong);
-#endif
-
-	regs->mepc += insn_len;
+	dec->len    = len;
+	dec->shift  = shift;
+	dec->fp	    = fp;
+	dec->reg    = reg;
+	dec->vector = vector;
+	dec->masked = vector && !((insn >> INSN_V_VM_SHIFT) & 1);
+	dec->base   = (insn >> SH_RS1) & 0x1f;
 
-	return 0;
+	return true;
 }
 
-static int sbi_trap_emulate_store(struct sbi_trap_context *tcntx,
-				  sbi_trap_st_emulator emu)
+static bool sbi_trap_decode_store(ulong insn, struct sbi_ldst_decode *dec)
 {
-	const struct sbi_trap_info *orig_trap = &tcntx->trap;
-	struct sbi_trap_regs *regs = &tcntx->regs;
-	ulong insn, insn_len;
-	union sbi_ldst_data val;
-	struct sbi_trap_info uptrap;
-	int rc, len = 0;
-
-	if (orig_trap->tinst & 0x1) {
-		/*
-		 * Bit[0] == 1 implies trapped instruction value is
-		 * transformed instruction or custom instruction.
-		 */
-		insn	 = orig_trap->tinst | INSN_16BIT_MASK;
-		insn_len = (orig_trap->tinst & 0x2) ? INSN_LEN(insn) : 2;
-	} else {
-		/*
-		 * Bit[0] == 0 implies trapped instruction value is
-		 * zero or special value.
-		 */
-		insn = sbi_get_insn(regs->mepc, &uptrap);
-		if (uptrap.cause) {
-			return sbi_trap_redirect(regs, &uptrap);
-		}
-		insn_len = INSN_LEN(insn);
-	}
-
-	val.data_ulong = GET_RS2(insn, regs);
+	int fp = 0, len = 0, vector = 0;
+	ulong reg = (insn >> SH_RS2) & 0x1f;
 
 	if ((insn & INSN_MASK_SB) == INSN_MATCH_SB) {
 		len = 1;
@@ -207,56 +247,249 @@ static int sbi_trap_emulate_store(struct sbi_trap_context *tcntx,
 #endif
 #ifdef __riscv_flen
 	} else if ((insn & INSN_MASK_FSD) == INSN_MATCH_FSD) {
-		len	     = 8;
-		val.data_u64 = GET_F64_RS2(insn, regs);
+		fp  = 1;
+		len = 8;
 	} else if ((insn & INSN_MASK_FSW) == INSN_MATCH_FSW) {
-		len	       = 4;
-		val.data_ulong = GET_F32_RS2(insn, regs);
+		fp  = 1;
+		len = 4;
 #endif
 	} else if ((insn & INSN_MASK_SH) == INSN_MATCH_SH) {
 		len = 2;
 #if __riscv_xlen >= 64
 	} else if ((insn & INSN_MASK_C_SD) == INSN_MATCH_C_SD) {
-		len	       = 8;
-		val.data_ulong = GET_RS2S(insn, regs);
+		len = 8;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_SDSP) == INSN_MATCH_C_SDSP) {
-		len	       = 8;
-		val.data_ulong = GET_RS2C(insn, regs);
+		len = 8;
+		reg = RVC_RS2(insn);
 #endif
 	} else if ((insn & INSN_MASK_C_SW) == INSN_MATCH_C_SW) {
-		len	       = 4;
-		val.data_ulong = GET_RS2S(insn, regs);
+		len = 4;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_SWSP) == INSN_MATCH_C_SWSP) {
-		len	       = 4;
-		val.data_ulong = GET_RS2C(insn, regs);
+		len = 4;
+		reg = RVC_RS2(insn);
 #ifdef __riscv_flen
 	} else if ((insn & INSN_MASK_C_FSD) == INSN_MATCH_C_FSD) {
-		len	     = 8;
-		val.data_u64 = GET_F64_RS2S(insn, regs);
+		fp  = 1;
+		len = 8;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FSDSP) == INSN_MATCH_C_FSDSP) {
-		len	     = 8;
-		val.data_u64 = GET_F64_RS2C(insn, regs);
+		fp  = 1;
+		len = 8;
+		reg = RVC_RS2(insn);
 #if __riscv_xlen == 32
 	} else if ((insn & INSN_MASK_C_FSW) == INSN_MATCH_C_FSW) {
-		len	       = 4;
-		val.data_ulong = GET_F32_RS2S(insn, regs);
+		fp  = 1;
+		len = 4;
+		reg = RVC_RS2S(insn);
 	} else if ((insn & INSN_MASK_C_FSWSP) == INSN_MATCH_C_FSWSP) {
-		len	       = 4;
-		val.data_ulong = GET_F32_RS2C(insn, regs);
+		fp  = 1;
+		len = 4;
+		reg = RVC_RS2(insn);
 #endif
 #endif
 	} else if ((insn & INSN_MASK_C_SH) == INSN_MATCH_C_SH) {
-		len		= 2;
-		val.data_ulong = GET_RS2S(insn, regs);
+		len = 2;
+		reg = RVC_RS2S(insn);
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	} else if ((insn & INSN_MASK_VSE8) == INSN_MATCH_VSE8) {
+		vector = 1;
+		len    = 1;
+	} else if ((insn & INSN_MASK_VSE16) == INSN_MATCH_VSE16) {
+		vector = 1;
+		len    = 2;
+	} else if ((insn & INSN_MASK_VSE32) == INSN_MATCH_VSE32) {
+		vector = 1;
+		len    = 4;
+	} else if ((insn & INSN_MASK_VSE64) == INSN_MATCH_VSE64) {
+		vector = 1;
+		len    = 8;
+#endif
 	} else {
+		return false;
+	}
+
+	/* Vector stores encode the source register group in the rd field */
+	if (vector)
+		reg = (insn >> SH_RD) & 0x1f;
+
+	dec->len    = len;
+	dec->shift  = 0;
+	dec->fp	    = fp;
+	dec->reg    = reg;
+	dec->vector = vector;
+	dec->masked = vector && !((insn >> INSN_V_VM_SHIFT) & 1);
+	dec->base   = (insn >> SH_RS1) & 0x1f;
+
+	return true;
+}
+
+/**
+ * Fetch and decode the trapped load or store instruction, using the
+ * decoded instruction cache of the hart when the fetched instruction
+ * matches the cached one.
+ *
+ * @return 0 with dec->len set on success, otherwise dec->len is zero and
+ * the trap was redirected with the returned result
+ */
+static int sbi_trap_ldst_decode(struct sbi_trap_context *tcntx, bool store,
+				struct sbi_ldst_decode *dec)
+{
+	const struct sbi_trap_info *orig_trap = &tcntx->trap;
+	struct sbi_trap_regs *regs = &tcntx->regs;
+	struct ldst_cache_entry *ent = NULL;
+	struct ldst_cache *lc;
+	struct sbi_trap_info uptrap;
+	ulong insn, insn_len, satp, tag = 0;
+	bool ok;
+
+	dec->len = 0;
+
+	if (orig_trap->tinst & 0x1) {
+		/*
+		 * Bit[0] == 1 implies trapped instruction value is
+		 * transformed instruction or custom instruction.
+		 */
+		insn	 = orig_trap->tinst | INSN_16BIT_MASK;
+		insn_len = (orig_trap->tinst & 0x2) ? INSN_LEN(insn) : 2;
+	} else {
+		/*
+		 * Bit[0] == 0 implies trapped instruction value is
+		 * zero or special value.
+		 */
+		insn = sbi_get_insn(regs->mepc, &uptrap);
+		if (uptrap.cause) {
+			return sbi_trap_redirect(regs, &uptrap);
+		}
+		insn_len = INSN_LEN(insn);
+	}
+
+	/*
+	 * Guest translations are not tracked so VS/VU-mode is not cached.
+	 * The code may have been modified since an entry was filled, so a
+	 * hit also needs the same instruction bits.
+	 */
+	lc = ldst_cache_thishart();
+	if (lc && !sbi_regs_from_virt(regs)) {
+		satp = csr_read(CSR_SATP);
+		if (lc->satp != satp) {
+			sbi_memset(lc->entries, 0, sizeof(lc->entries));
+			lc->satp = satp;
+		}
+
+		tag = ldst_cache_tag(regs, store);
+		ent = &lc->entries[(regs->mepc >> 1) & (LDST_CACHE_ENTRIES - 1)];
+		if (ent->pc == regs->mepc && ent->tag == tag &&
+		    ent->insn == insn && ent->dec.insn_len == insn_len) {
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_LDST_DECODE_HIT);
+			*dec = ent->dec;
+			return 0;
+		}
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_LDST_DECODE_MISS);
+	}
+
+	if (store)
+		ok = sbi_trap_decode_store(insn, dec);
+	else
+		ok = sbi_trap_decode_load(insn, dec);
+	if (!ok)
 		return sbi_trap_redirect(regs, orig_trap);
+	dec->insn_len = insn_len;
+
+	if (ent) {
+		ent->pc	 = regs->mepc;
+		ent->tag = tag;
+		ent->insn = insn;
+		ent->dec = *dec;
 	}
 
-	rc = emu(len, val, tcntx);
+	return 0;
+}
+
+static int sbi_trap_emulate_vector(struct sbi_trap_context *tcntx,
+				   const struct sbi_ldst_decode *dec,
+				   sbi_trap_v_emulator vemu)
+{
+	int rc;
+
+	if (!vemu)
+		return sbi_trap_redirect(&tcntx->regs, &tcntx->trap);
+
+	rc = vemu(dec, tcntx);
+	if (rc <= 0)
+		return rc;
+
+	tcntx->regs.mepc += dec->insn_len;
+
+	return 0;
+}
+
+static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
+				 sbi_trap_ld_emulator emu,
+				 sbi_trap_v_emulator vemu)
+{
+	struct sbi_trap_regs *regs = &tcntx->regs;
+	union sbi_ldst_data val = { 0 };
+	struct sbi_ldst_decode dec;
+	int rc;
+
+	rc = sbi_trap_ldst_decode(tcntx, false, &dec);
+	if (rc || !dec.len)
+		return rc;
+
+	if (dec.vector)
+		return sbi_trap_emulate_vector(tcntx, &dec, vemu);
+
+	rc = emu(dec.len, &val, tcntx);
 	if (rc <= 0)
 		return rc;
 
-	regs->mepc += insn_len;
+	if (!dec.fp)
+		SET_RD(dec.reg << SH_RD, regs,
+		       ((long)(val.data_ulong << dec.shift)) >> dec.shift);
+#ifdef __riscv_flen
+	else if (dec.len == 8)
+		SET_F64_RD(dec.reg << SH_RD, regs, val.data_u64);
+	else
+		SET_F32_RD(dec.reg << SH_RD, regs, val.data_ulong);
+#endif
+
+	regs->mepc += dec.insn_len;
+
+	return 0;
+}
+
+static int sbi_trap_emulate_store(struct sbi_trap_context *tcntx,
+				  sbi_trap_st_emulator emu,
+				  sbi_trap_v_emulator vemu)
+{
+	struct sbi_trap_regs *regs = &tcntx->regs;
+	union sbi_ldst_data val;
+	struct sbi_ldst_decode dec;
+	int rc;
+
+	rc = sbi_trap_ldst_decode(tcntx, true, &dec);
+	if (rc || !dec.len)
+		return rc;
+
+	if (dec.vector)
+		return sbi_trap_emulate_vector(tcntx, &dec, vemu);
+
+	if (!dec.fp)
+		val.data_ulong = GET_RS2(dec.reg << SH_RS2, regs);
+#ifdef __riscv_flen
+	else if (dec.len == 8)
+		val.data_u64 = GET_F64_RS2(dec.reg << SH_RS2, regs);
+	else
+		val.data_ulong = GET_F32_RS2(dec.reg << SH_RS2, regs);
+#endif
+
+	rc = emu(dec.len, val, tcntx);
+	if (rc <= 0)
+		return rc;
+
+	regs->mepc += dec.insn_len;
 
 	return 0;
 }
@@ -267,23 +500,22 @@ static int sbi_misaligned_ld_emulator(int rlen, union sbi_ldst_data *out_val,
 	const struct sbi_trap_info *orig_trap = &tcntx->trap;
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	struct sbi_trap_info uptrap;
-	int i;
-
-	for (i = 0; i < rlen; i++) {
-		out_val->data_bytes[i] =
-			sbi_load_u8((void *)(orig_trap->tval + i), &uptrap);
-		if (uptrap.cause) {
-			uptrap.tinst = sbi_misaligned_tinst_fixup(
-				orig_trap->tinst, uptrap.tinst, i);
-			return sbi_trap_redirect(regs, &uptrap);
-		}
+	ulong done;
+
+	done = sbi_load_misaligned((void *)orig_trap->tval,
+				   out_val->data_bytes, rlen, &uptrap);
+	if (uptrap.cause) {
+		uptrap.tinst = sbi_misaligned_tinst_fixup(
+			orig_trap->tinst, uptrap.tinst, done);
+		return sbi_trap_redirect(regs, &uptrap);
 	}
 	return rlen;
 }
 
 int sbi_misaligned_load_handler(struct sbi_trap_context *tcntx)
 {
-	return sbi_trap_emulate_load(tcntx, sbi_misaligned_ld_emulator);
+	return sbi_trap_emulate_load(tcntx, sbi_misaligned_ld_emulator,
+				     sbi_misaligned_v_ld_emulator);
 }
 
 static int sbi_misaligned_st_emulator(int wlen, union sbi_ldst_data in_val,
@@ -292,23 +524,22 @@ static int sbi_misaligned_st_emulator(int wlen, union sbi_ldst_data in_val,
 	const struct sbi_trap_info *orig_trap = &tcntx->trap;
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	struct sbi_trap_info uptrap;
-	int i;
-
-	for (i = 0; i < wlen; i++) {
-		sbi_store_u8((void *)(orig_trap->tval + i),
-			     in_val.data_bytes[i], &uptrap);
-		if (uptrap.cause) {
-			uptrap.tinst = sbi_misaligned_tinst_fixup(
-				orig_trap->tinst, uptrap.tinst, i);
-			return sbi_trap_redirect(regs, &uptrap);
-		}
+	ulong done;
+
+	done = sbi_store_misaligned((void *)orig_trap->tval,
+				    in_val.data_bytes, wlen, &uptrap);
+	if (uptrap.cause) {
+		uptrap.tinst = sbi_misaligned_tinst_fixup(
+			orig_trap->tinst, uptrap.tinst, done);
+		return sbi_trap_redirect(regs, &uptrap);
 	}
 	return wlen;
 }
 
 int sbi_misaligned_store_handler(struct sbi_trap_context *tcntx)
 {
-	return sbi_trap_emulate_store(tcntx, sbi_misaligned_st_emulator);
+	return sbi_trap_emulate_store(tcntx, sbi_misaligned_st_emulator,
+				      sbi_misaligned_v_st_emulator);
 }
 
 static int sbi_ld_access_emulator(int rlen, union sbi_ldst_data *out_val,
@@ -331,7 +562,7 @@ static int sbi_ld_access_emulator(int rlen, union sbi_ldst_data *out_val,
 
 int sbi_load_access_handler(struct sbi_trap_context *tcntx)
 {
-	return sbi_trap_emulate_load(tcntx, sbi_ld_access_emulator);
+	return sbi_trap_emulate_load(tcntx, sbi_ld_access_emulator, NULL);
 }
 
 static int sbi_st_access_emulator(int wlen, union sbi_ldst_data in_val,
@@ -354,5 +585,5 @@ static int sbi_st_access_emulator(int wlen, union sbi_ldst_data in_val,
 
 int sbi_store_access_handler(struct sbi_trap_context *tcntx)
 {
-	return sbi_trap_emulate_store(tcntx, sbi_st_access_emulator);
+	return sbi_trap_emulate_store(tcntx, sbi_st_access_emulator, NULL);
 }
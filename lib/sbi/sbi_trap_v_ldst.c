@@ -0,0 +1,221 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Misaligned vector unit-stride load/store emulation
+ *
+ * Active elements are moved one at a time between memory and the vector
+ * register file. Vector registers are accessed from M-mode with e8/m8
+ * unit-stride accesses which start at vstart, so only the bytes of the
+ * element are touched.
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_trap_ldst.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unpriv.h>
+
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+
+static inline void vsetvl(ulong vl, ulong vtype)
+{
+	asm volatile(".option push\n"
+		     ".option arch, +v\n"
+		     "vsetvl x0, %0, %1\n"
+		     ".option pop"
+		     : : "r"(vl), "r"(vtype));
+}
+
+/* Byte position of an element byte in the m8 group of its register */
+static inline ulong vreg_pos(ulong vlenb, ulong which, ulong pos)
+{
+	return ((which + pos / vlenb) % 8) * vlenb + pos % vlenb;
+}
+
+static void get_vreg(ulong vlenb, ulong which, ulong pos, ulong size,
+		     u8 *bytes)
+{
+	ulong group = (which + pos / vlenb) / 8;
+
+	pos = vreg_pos(vlenb, which, pos);
+	bytes -= pos;
+
+	asm volatile(".option push\n"
+		     ".option arch, +v\n"
+		     "vsetvli x0, %0, e8, m8, tu, ma\n"
+		     ".option pop"
+		     : : "r"(pos + size));
+	csr_write(CSR_VSTART, pos);
+
+	switch (group) {
+	case 0:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vse8.v v0, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 1:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vse8.v v8, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 2:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vse8.v v16, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 3:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vse8.v v24, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	}
+}
+
+static void set_vreg(ulong vlenb, ulong which, ulong pos, ulong size,
+		     const u8 *bytes)
+{
+	ulong group = (which + pos / vlenb) / 8;
+
+	pos = vreg_pos(vlenb, which, pos);
+	bytes -= pos;
+
+	asm volatile(".option push\n"
+		     ".option arch, +v\n"
+		     "vsetvli x0, %0, e8, m8, tu, ma\n"
+		     ".option pop"
+		     : : "r"(pos + size));
+	csr_write(CSR_VSTART, pos);
+
+	switch (group) {
+	case 0:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vle8.v v0, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 1:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vle8.v v8, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 2:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vle8.v v16, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	case 3:
+		asm volatile(".option push\n"
+			     ".option arch, +v\n"
+			     "vle8.v v24, (%0)\n"
+			     ".option pop"
+			     : : "r"(bytes) : "memory");
+		break;
+	}
+}
+
+static bool vreg_elem_active(ulong vlenb, const struct sbi_ldst_decode *dec,
+			     ulong elem, u8 *mask)
+{
+	if (!dec->masked)
+		return true;
+
+	/* Fetch the next byte of v0 when entering a new group of 8 */
+	if (!(elem % 8))
+		get_vreg(vlenb, 0, elem / 8, 1, mask);
+
+	return (*mask >> (elem % 8)) & 1;
+}
+
+static int sbi_misaligned_v_emulate(const struct sbi_ldst_decode *dec,
+				    struct sbi_trap_context *tcntx,
+				    bool store)
+{
+	const struct sbi_trap_info *orig_trap = &tcntx->trap;
+	struct sbi_trap_regs *regs = &tcntx->regs;
+	ulong vl = csr_read(CSR_VL);
+	ulong vtype = csr_read(CSR_VTYPE);
+	ulong vlenb = csr_read(CSR_VLENB);
+	ulong vstart = csr_read(CSR_VSTART);
+	ulong base = GET_RS1((ulong)dec->base << SH_RS1, regs);
+	ulong len = dec->len, addr, done;
+	struct sbi_trap_info uptrap;
+	u8 bytes[8], mask = 0;
+
+	/* Load the mask byte of a group entered in the middle */
+	if (dec->masked && vstart < vl && (vstart % 8))
+		get_vreg(vlenb, 0, vstart / 8, 1, &mask);
+
+	for (; vstart < vl; vstart++) {
+		if (!vreg_elem_active(vlenb, dec, vstart, &mask))
+			continue;
+
+		addr = base + vstart * len;
+		if (store) {
+			get_vreg(vlenb, dec->reg, vstart * len, len, bytes);
+			done = sbi_store_misaligned((void *)addr, bytes, len,
+						    &uptrap);
+		} else {
+			done = sbi_load_misaligned((void *)addr, bytes, len,
+						   &uptrap);
+		}
+		if (uptrap.cause) {
+			/* Resume from the faulting element once handled */
+			vsetvl(vl, vtype);
+			csr_write(CSR_VSTART, vstart);
+			uptrap.tinst = sbi_misaligned_tinst_fixup(
+				orig_trap->tinst, uptrap.tinst, done);
+			return sbi_trap_redirect(regs, &uptrap);
+		}
+		if (!store)
+			set_vreg(vlenb, dec->reg, vstart * len, len, bytes);
+	}
+
+	vsetvl(vl, vtype);
+	csr_write(CSR_VSTART, 0);
+	if (!store)
+		regs->mstatus |= MSTATUS_VS;
+
+	return 1;
+}
+
+int sbi_misaligned_v_ld_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx)
+{
+	return sbi_misaligned_v_emulate(dec, tcntx, false);
+}
+
+int sbi_misaligned_v_st_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx)
+{
+	return sbi_misaligned_v_emulate(dec, tcntx, true);
+}
+
+#else
+
+int sbi_misaligned_v_ld_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx)
+{
+	return sbi_trap_redirect(&tcntx->regs, &tcntx->trap);
+}
+
+int sbi_misaligned_v_st_emulator(const struct sbi_ldst_decode *dec,
+				 struct sbi_trap_context *tcntx)
+{
+	return sbi_trap_redirect(&tcntx->regs, &tcntx->trap);
+}
+
+#endif
@@ -7,10 +7,12 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_unpriv.h>
 
@@ -116,6 +118,172 @@ void sbi_store_u64(u64 *addr, u64 val,
 # error "Unexpected __riscv_xlen"
 #endif
 
+/*
+ * Load up to one register worth of bytes from a misaligned address with
+ * at most two naturally aligned loads inside a single MPRV window. The
+ * trap handler sets a4 on a fault so the second load is skipped.
+ */
+static ulong unpriv_load_window(ulong addr, ulong len,
+				struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4") = 0;
+	register ulong mstatus = 0;
+	register ulong mtvec = sbi_hart_expected_trap_addr();
+	ulong base = addr & ~(REGBYTES - 1), off = addr & (REGBYTES - 1);
+	ulong two = (off + len > REGBYTES) ? 1 : 0;
+	ulong lo = 0, hi = 0;
+
+	trap->cause = 0;
+
+	asm volatile(
+	    "csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"
+	    "csrrs %[mstatus], " STR(CSR_MSTATUS) ", %[mprv]\n"
+	    ".option push\n"
+	    ".option norvc\n"
+	    REG_L " %[lo], 0(%[base])\n"
+	    "bnez %[ttmp], 1f\n"
+	    "beqz %[two], 1f\n"
+	    REG_L " %[hi], " SZREG "(%[base])\n"
+	    "1:\n"
+	    ".option pop\n"
+	    "csrw " STR(CSR_MSTATUS) ", %[mstatus]\n"
+	    "csrw " STR(CSR_MTVEC) ", %[mtvec]"
+	    : [mstatus] "+&r"(mstatus), [mtvec] "+&r"(mtvec),
+	      [tinfo] "+&r"(tinfo), [ttmp] "+&r"(ttmp),
+	      [lo] "+&r"(lo), [hi] "+&r"(hi)
+	    : [mprv] "r"(MSTATUS_MPRV), [base] "r"(base), [two] "r"(two)
+	    : "memory");
+
+	if (trap->cause)
+		return 0;
+
+	lo >>= 8 * off;
+	if (two)
+		lo |= hi << (8 * (REGBYTES - off));
+
+	return lo;
+}
+
+/*
+ * Store up to one register worth of bytes to a misaligned address inside
+ * a single MPRV window. Wider stores would overwrite neighbouring bytes,
+ * so the range is split into the largest naturally aligned pieces. The
+ * trap handler sets a4 on a fault which stops the remaining pieces.
+ */
+static void unpriv_store_window(ulong addr, ulong val, ulong len,
+				struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4") = 0;
+	register ulong mstatus = 0;
+	register ulong mtvec = sbi_hart_expected_trap_addr();
+	ulong tmp;
+
+	trap->cause = 0;
+
+	asm volatile(
+	    "csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"
+	    "csrrs %[mstatus], " STR(CSR_MSTATUS) ", %[mprv]\n"
+	    ".option push\n"
+	    ".option norvc\n"
+	    "1: beqz %[len], 9f\n"
+	    "andi %[tmp], %[addr], 1\n"
+	    "bnez %[tmp], 2f\n"
+	    "sltiu %[tmp], %[len], 2\n"
+	    "bnez %[tmp], 2f\n"
+	    "andi %[tmp], %[addr], 2\n"
+	    "bnez %[tmp], 3f\n"
+	    "sltiu %[tmp], %[len], 4\n"
+	    "bnez %[tmp], 3f\n"
+#if __riscv_xlen == 64
+	    "andi %[tmp], %[addr], 4\n"
+	    "bnez %[tmp], 4f\n"
+	    "sltiu %[tmp], %[len], 8\n"
+	    "bnez %[tmp], 4f\n"
+	    "li %[tmp], 8\n"
+	    "sd %[val], 0(%[addr])\n"
+	    "j 5f\n"
+#endif
+	    "4: li %[tmp], 4\n"
+	    "sw %[val], 0(%[addr])\n"
+	    "j 5f\n"
+	    "3: li %[tmp], 2\n"
+	    "sh %[val], 0(%[addr])\n"
+	    "j 5f\n"
+	    "2: li %[tmp], 1\n"
+	    "sb %[val], 0(%[addr])\n"
+	    "5: bnez %[ttmp], 9f\n"
+	    "add %[addr], %[addr], %[tmp]\n"
+	    "sub %[len], %[len], %[tmp]\n"
+	    "slli %[tmp], %[tmp], 3\n"
+	    "srl %[val], %[val], %[tmp]\n"
+	    "j 1b\n"
+	    "9:\n"
+	    ".option pop\n"
+	    "csrw " STR(CSR_MSTATUS) ", %[mstatus]\n"
+	    "csrw " STR(CSR_MTVEC) ", %[mtvec]"
+	    : [mstatus] "+&r"(mstatus), [mtvec] "+&r"(mtvec),
+	      [tinfo] "+&r"(tinfo), [ttmp] "+&r"(ttmp), [tmp] "=&r"(tmp),
+	      [addr] "+&r"(addr), [val] "+&r"(val), [len] "+&r"(len)
+	    : [mprv] "r"(MSTATUS_MPRV)
+	    : "memory");
+}
+
+ulong sbi_load_misaligned(const void *addr, void *data, ulong len,
+			  struct sbi_trap_info *trap)
+{
+	ulong i, j, chunk, val;
+	u8 *bytes = data;
+
+	for (i = 0; i < len; i += chunk) {
+		chunk = (len - i < REGBYTES) ? len - i : REGBYTES;
+		val = unpriv_load_window((ulong)addr + i, chunk, trap);
+		if (!trap->cause) {
+			sbi_memcpy(&bytes[i], &val, chunk);
+			continue;
+		}
+
+		/*
+		 * The wider loads also touch bytes outside the range so
+		 * redo the chunk byte by byte to find the precise fault.
+		 */
+		for (j = 0; j < chunk; j++) {
+			bytes[i + j] = sbi_load_u8((const u8 *)addr + i + j,
+						   trap);
+			if (trap->cause)
+				return i + j;
+		}
+	}
+
+	return len;
+}
+
+ulong sbi_store_misaligned(void *addr, const void *data, ulong len,
+			   struct sbi_trap_info *trap)
+{
+	ulong i, j, chunk, val;
+	const u8 *bytes = data;
+
+	for (i = 0; i < len; i += chunk) {
+		chunk = (len - i < REGBYTES) ? len - i : REGBYTES;
+		val = 0;
+		sbi_memcpy(&val, &bytes[i], chunk);
+		unpriv_store_window((ulong)addr + i, val, chunk, trap);
+		if (!trap->cause)
+			continue;
+
+		/* Redo the chunk byte by byte to find the precise fault */
+		for (j = 0; j < chunk; j++) {
+			sbi_store_u8((u8 *)addr + i + j, bytes[i + j], trap);
+			if (trap->cause)
+				return i + j;
+		}
+	}
+
+	return len;
+}
+
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 {
 	register ulong tinfo asm("a3");
@@ -4,6 +4,9 @@ libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_unit_tests.carray.o
 carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += bitmap_test_suite
 libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_bitmap_test.o
 
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += hartmask_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_hartmask_test.o
+
 carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += console_test_suite
 libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_console_test.o
 
@@ -14,4 +17,19 @@ carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += locks_test_suite
 libsbi-objs-$(CONFIG_SBIUNIT) += tests/riscv_locks_test.o
 
 carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += math_test_suite
-libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_math_test.o
\ No newline at end of file
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_math_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += mpsc_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_mpsc_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += tlb_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_tlb_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += scratch_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_scratch_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += ecall_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_ecall_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += heap_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_heap_test.o
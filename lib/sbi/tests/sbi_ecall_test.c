@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_unit_test.h>
+
+#define ECALL_TEST_ROUNDS	64
+
+extern struct sbi_ecall_extension *sbi_ecall_exts[];
+extern unsigned long sbi_ecall_exts_size;
+
+static const unsigned long ecall_test_hot_ids[] = {
+	SBI_EXT_TIME, SBI_EXT_IPI, SBI_EXT_RFENCE, SBI_EXT_PMU,
+	SBI_EXT_VENDOR_START, SBI_EXT_FIRMWARE_END,
+};
+
+/* Linear walk in registration order, like lookups over the list */
+static struct sbi_ecall_extension *ecall_test_scan(unsigned long extid)
+{
+	struct sbi_ecall_extension *ext;
+	unsigned long i;
+
+	for (i = 0; i < sbi_ecall_exts_size; i++) {
+		ext = sbi_ecall_exts[i];
+		if (ext->extid_start <= extid && extid <= ext->extid_end)
+			return ext;
+	}
+
+	return NULL;
+}
+
+static void ecall_find_test(struct sbiunit_test_case *test)
+{
+	struct sbi_ecall_extension *ext;
+	unsigned long i;
+
+	for (i = 0; i < sbi_ecall_exts_size; i++) {
+		ext = sbi_ecall_exts[i];
+
+		/* Extension is either not registered or found at both ends */
+		if (sbi_ecall_find_extension(ext->extid_start) != ext)
+			continue;
+		SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(ext->extid_end),
+				  ext);
+		if (ext->extid_start)
+			SBIUNIT_EXPECT_NE(test,
+				sbi_ecall_find_extension(ext->extid_start - 1),
+				ext);
+		if (ext->extid_end != -1UL)
+			SBIUNIT_EXPECT_NE(test,
+				sbi_ecall_find_extension(ext->extid_end + 1),
+				ext);
+	}
+
+	SBIUNIT_EXPECT_EQ(test, sbi_ecall_find_extension(-1UL), NULL);
+}
+
+static void ecall_find_bench(struct sbiunit_test_case *test)
+{
+	struct sbi_ecall_extension *volatile sink;
+	unsigned long i, j, start, table, scan;
+
+	for (j = 0; j < array_size(ecall_test_hot_ids); j++) {
+		start = csr_read(CSR_MCYCLE);
+		for (i = 0; i < ECALL_TEST_ROUNDS; i++)
+			sink = sbi_ecall_find_extension(ecall_test_hot_ids[j]);
+		table = csr_read(CSR_MCYCLE) - start;
+
+		start = csr_read(CSR_MCYCLE);
+		for (i = 0; i < ECALL_TEST_ROUNDS; i++)
+			sink = ecall_test_scan(ecall_test_hot_ids[j]);
+		scan = csr_read(CSR_MCYCLE) - start;
+
+		sbi_printf("%s: ext 0x%lx: table %lu cycles, scan %lu cycles\n",
+			   test->name, ecall_test_hot_ids[j],
+			   table / ECALL_TEST_ROUNDS, scan / ECALL_TEST_ROUNDS);
+	}
+
+	(void)sink;
+}
+
+static struct sbiunit_test_case ecall_test_cases[] = {
+	SBIUNIT_TEST_CASE(ecall_find_test),
+	SBIUNIT_TEST_CASE(ecall_find_bench),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(ecall_test_suite, ecall_test_cases);
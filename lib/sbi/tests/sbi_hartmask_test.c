@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_unit_test.h>
+
+#define HARTMASK_LAST	(SBI_HARTMASK_MAX_BITS - 1)
+
+static void hartmask_iter_test(struct sbiunit_test_case *test)
+{
+	static const u32 idx[] = { 0, 1, BITS_PER_LONG, HARTMASK_LAST };
+	struct sbi_hartmask m;
+	u32 i, n = 0;
+
+	/* Clearing only resets the summary, stale words must not leak */
+	sbi_hartmask_set_all(&m);
+	sbi_hartmask_clear_all(&m);
+	sbi_hartmask_for_each_hartindex(i, &m)
+		n++;
+	SBIUNIT_EXPECT_EQ(test, n, 0);
+
+	for (i = 0; i < array_size(idx); i++)
+		sbi_hartmask_set_hartindex(idx[i], &m);
+	sbi_hartmask_set_hartindex(SBI_HARTMASK_MAX_BITS, &m);
+
+	sbi_hartmask_for_each_hartindex(i, &m) {
+		SBIUNIT_ASSERT(test, n < array_size(idx));
+		SBIUNIT_EXPECT_EQ(test, i, idx[n]);
+		n++;
+	}
+	SBIUNIT_EXPECT_EQ(test, n, array_size(idx));
+
+	sbi_hartmask_clear_hartindex(BITS_PER_LONG, &m);
+	SBIUNIT_EXPECT(test, !sbi_hartmask_test_hartindex(BITS_PER_LONG, &m));
+	SBIUNIT_EXPECT_EQ(test, sbi_hartmask_next_hartindex(&m, 2),
+			  HARTMASK_LAST);
+}
+
+static void hartmask_ops_test(struct sbiunit_test_case *test)
+{
+	struct sbi_hartmask a, b, r;
+
+	sbi_hartmask_clear_all(&a);
+	sbi_hartmask_clear_all(&b);
+	sbi_hartmask_set_hartindex(1, &a);
+	sbi_hartmask_set_hartindex(HARTMASK_LAST, &a);
+	sbi_hartmask_set_hartindex(HARTMASK_LAST, &b);
+	sbi_hartmask_set_hartindex(2, &b);
+
+	sbi_hartmask_and(&r, &a, &b);
+	SBIUNIT_EXPECT(test, !sbi_hartmask_test_hartindex(1, &r));
+	SBIUNIT_EXPECT(test, !sbi_hartmask_test_hartindex(2, &r));
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(HARTMASK_LAST, &r));
+	/* The low word of the result is empty and skipped */
+	SBIUNIT_EXPECT_EQ(test, sbi_hartmask_next_hartindex(&r, 0),
+			  HARTMASK_LAST);
+
+	sbi_hartmask_or(&r, &a, &b);
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(1, &r));
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(2, &r));
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(HARTMASK_LAST, &r));
+
+	sbi_hartmask_xor(&r, &a, &b);
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(1, &r));
+	SBIUNIT_EXPECT(test, sbi_hartmask_test_hartindex(2, &r));
+	SBIUNIT_EXPECT(test, !sbi_hartmask_test_hartindex(HARTMASK_LAST, &r));
+
+	/* In place and with aliased sources */
+	sbi_hartmask_copy(&r, &a);
+	sbi_hartmask_and(&r, &r, &b);
+	SBIUNIT_EXPECT_EQ(test, sbi_hartmask_next_hartindex(&r, 0),
+			  HARTMASK_LAST);
+	sbi_hartmask_xor(&r, &r, &r);
+	SBIUNIT_EXPECT_EQ(test, sbi_hartmask_next_hartindex(&r, 0),
+			  SBI_HARTMASK_MAX_BITS);
+}
+
+static struct sbiunit_test_case hartmask_test_cases[] = {
+	SBIUNIT_TEST_CASE(hartmask_iter_test),
+	SBIUNIT_TEST_CASE(hartmask_ops_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(hartmask_test_suite, hartmask_test_cases);
@@ -0,0 +1,265 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_unit_test.h>
+
+#ifdef CONFIG_SBI_HEAP_SLAB
+#define HEAP_TEST_SLAB		true
+#else
+#define HEAP_TEST_SLAB		false
+#endif
+
+#ifdef CONFIG_SBI_HEAP_MAGAZINE
+#define HEAP_TEST_MAGAZINE	true
+#else
+#define HEAP_TEST_MAGAZINE	false
+#endif
+
+#define HEAP_TEST_SIZE		(4 * SBI_HEAP_SLAB_SIZE)
+#define HEAP_TEST_OBJS		256
+#define HEAP_TEST_ROUNDS	64
+#define HEAP_TEST_MAG_OBJS	16
+
+static void *heap_test_mem;
+
+/* Private heap so that tests neither depend on nor disturb the global one */
+static struct sbi_heap_control *heap_test_create(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl;
+
+	heap_test_mem = sbi_aligned_alloc(SBI_HEAP_SLAB_SIZE, HEAP_TEST_SIZE);
+	SBIUNIT_ASSERT_NE(test, heap_test_mem, NULL);
+	sbi_heap_alloc_new(&hpctrl);
+	SBIUNIT_ASSERT_NE(test, hpctrl, NULL);
+	SBIUNIT_ASSERT_EQ(test, sbi_heap_init_new(hpctrl,
+						  (unsigned long)heap_test_mem,
+						  HEAP_TEST_SIZE), 0);
+
+	return hpctrl;
+}
+
+static void heap_test_destroy(struct sbi_heap_control *hpctrl)
+{
+	sbi_free(hpctrl);
+	sbi_free(heap_test_mem);
+}
+
+static void heap_size_class_test(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	unsigned long free = sbi_heap_free_space_from(hpctrl);
+	unsigned long size, class;
+	u8 *a, *b;
+
+	for (size = 1; size <= SBI_HEAP_SLAB_SIZE; size = size * 2 + 1) {
+		class = 64;
+		while (class < size)
+			class <<= 1;
+
+		a = sbi_malloc_from(hpctrl, size);
+		b = sbi_malloc_from(hpctrl, size);
+		SBIUNIT_ASSERT_NE(test, a, NULL);
+		SBIUNIT_ASSERT_NE(test, b, NULL);
+		SBIUNIT_EXPECT(test, a + size <= b || b + size <= a);
+		if (HEAP_TEST_SLAB) {
+			/* Slab objects are naturally aligned to their class */
+			SBIUNIT_EXPECT_EQ(test, (unsigned long)a % class, 0);
+			SBIUNIT_EXPECT_EQ(test, (unsigned long)b % class, 0);
+		}
+
+		sbi_memset(a, 0x5a, size);
+		sbi_memset(b, 0xa5, size);
+		SBIUNIT_EXPECT_EQ(test, a[size - 1], 0x5a);
+		SBIUNIT_EXPECT_EQ(test, b[0], 0xa5);
+
+		sbi_free_from(hpctrl, a);
+		sbi_free_from(hpctrl, b);
+	}
+
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space_from(hpctrl), free);
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_reuse_test(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	void *a, *b, *c;
+
+	if (!HEAP_TEST_SLAB)
+		goto out;
+
+	/* Most recently freed object is handed out first */
+	a = sbi_malloc_from(hpctrl, 100);
+	b = sbi_malloc_from(hpctrl, 100);
+	sbi_free_from(hpctrl, a);
+	c = sbi_zalloc_from(hpctrl, 128);
+	SBIUNIT_EXPECT_EQ(test, c, a);
+	SBIUNIT_EXPECT_EQ(test, ((u8 *)c)[0], 0);
+
+	sbi_free_from(hpctrl, b);
+	sbi_free_from(hpctrl, c);
+
+out:
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_large_aligned_test(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	unsigned long free = sbi_heap_free_space_from(hpctrl);
+	void *large, *aligned;
+
+	large = sbi_malloc_from(hpctrl, SBI_HEAP_SLAB_SIZE + 1);
+	SBIUNIT_EXPECT_NE(test, large, NULL);
+	aligned = sbi_aligned_alloc_from(hpctrl, 1024, 1024);
+	SBIUNIT_EXPECT_NE(test, aligned, NULL);
+	SBIUNIT_EXPECT_EQ(test, (unsigned long)aligned % 1024, 0);
+
+	SBIUNIT_EXPECT(test, free - sbi_heap_free_space_from(hpctrl) >=
+			     SBI_HEAP_SLAB_SIZE + 1024);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_used_space_from(hpctrl) +
+				sbi_heap_free_space_from(hpctrl) +
+				sbi_heap_reserved_space_from(hpctrl),
+			  HEAP_TEST_SIZE);
+
+	sbi_free_from(hpctrl, large);
+	sbi_free_from(hpctrl, aligned);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space_from(hpctrl), free);
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_coalesce_test(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	unsigned long i, free = sbi_heap_free_space_from(hpctrl);
+	void *blocks[3], *all;
+
+	for (i = 0; i < array_size(blocks); i++) {
+		blocks[i] = sbi_malloc_from(hpctrl, SBI_HEAP_SLAB_SIZE + 64);
+		SBIUNIT_ASSERT_NE(test, blocks[i], NULL);
+	}
+
+	/* Freeing the middle block last must merge it with both neighbours */
+	sbi_free_from(hpctrl, blocks[0]);
+	sbi_free_from(hpctrl, blocks[2]);
+	sbi_free_from(hpctrl, blocks[1]);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space_from(hpctrl), free);
+
+	all = sbi_malloc_from(hpctrl, free);
+	SBIUNIT_EXPECT_NE(test, all, NULL);
+	sbi_free_from(hpctrl, all);
+
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_exhaust_test(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	unsigned long i, count, free = sbi_heap_free_space_from(hpctrl);
+	void **objs = sbi_calloc(HEAP_TEST_OBJS, sizeof(*objs));
+
+	SBIUNIT_ASSERT_NE(test, objs, NULL);
+
+	/* Fill the heap with small objects until nothing is left */
+	for (count = 0; count < HEAP_TEST_OBJS; count++) {
+		objs[count] = sbi_malloc_from(hpctrl, 64);
+		if (!objs[count])
+			break;
+	}
+	if (HEAP_TEST_SLAB)
+		SBIUNIT_EXPECT(test, count * 64 >= HEAP_TEST_SIZE / 2);
+	SBIUNIT_EXPECT_EQ(test, sbi_malloc_from(hpctrl, SBI_HEAP_SLAB_SIZE),
+			  NULL);
+
+	/* Once freed, every slab chunk must be usable by other allocations */
+	for (i = 0; i < count; i++)
+		sbi_free_from(hpctrl, objs[i]);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space_from(hpctrl), free);
+	for (i = 0; i < HEAP_TEST_SIZE / SBI_HEAP_SLAB_SIZE - 1; i++) {
+		objs[i] = sbi_aligned_alloc_from(hpctrl, SBI_HEAP_SLAB_SIZE,
+						 SBI_HEAP_SLAB_SIZE);
+		SBIUNIT_EXPECT_NE(test, objs[i], NULL);
+	}
+	while (i--)
+		sbi_free_from(hpctrl, objs[i]);
+
+	sbi_free(objs);
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_small_bench(struct sbiunit_test_case *test)
+{
+	struct sbi_heap_control *hpctrl = heap_test_create(test);
+	void *live[16], *volatile obj;
+	unsigned long i, start, slab, ffit;
+
+	/* Keep some live allocations around so that lists are not trivial */
+	for (i = 0; i < array_size(live); i++)
+		live[i] = sbi_aligned_alloc_from(hpctrl, 64, 64 * (i + 1));
+
+	start = csr_read(CSR_MCYCLE);
+	for (i = 0; i < HEAP_TEST_ROUNDS; i++) {
+		obj = sbi_malloc_from(hpctrl, 64);
+		sbi_free_from(hpctrl, obj);
+	}
+	slab = csr_read(CSR_MCYCLE) - start;
+
+	/* Aligned allocations always go to the first-fit allocator */
+	start = csr_read(CSR_MCYCLE);
+	for (i = 0; i < HEAP_TEST_ROUNDS; i++) {
+		obj = sbi_aligned_alloc_from(hpctrl, 64, 64);
+		sbi_free_from(hpctrl, obj);
+	}
+	ffit = csr_read(CSR_MCYCLE) - start;
+
+	sbi_printf("%s: 64 byte alloc/free: malloc %lu cycles, first-fit %lu cycles\n",
+		   test->name, slab / HEAP_TEST_ROUNDS, ffit / HEAP_TEST_ROUNDS);
+
+	for (i = 0; i < array_size(live); i++)
+		sbi_free_from(hpctrl, live[i]);
+	heap_test_destroy(hpctrl);
+}
+
+static void heap_magazine_test(struct sbiunit_test_case *test)
+{
+	unsigned long i, free = sbi_heap_free_space();
+	void *objs[HEAP_TEST_MAG_OBJS], *a;
+
+	if (!HEAP_TEST_MAGAZINE)
+		return;
+
+	/* Objects freed by this hart are reused first */
+	a = sbi_malloc(64);
+	SBIUNIT_ASSERT_NE(test, a, NULL);
+	sbi_free(a);
+	SBIUNIT_EXPECT_EQ(test, sbi_malloc(64), a);
+	sbi_free(a);
+
+	/* More objects than the cache holds refill and drain it in batches */
+	for (i = 0; i < HEAP_TEST_MAG_OBJS; i++) {
+		objs[i] = sbi_malloc(200);
+		SBIUNIT_EXPECT_NE(test, objs[i], NULL);
+	}
+	for (i = 0; i < HEAP_TEST_MAG_OBJS; i++)
+		sbi_free(objs[i]);
+
+	/* Cached objects still count as free space */
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space(), free);
+}
+
+static struct sbiunit_test_case heap_test_cases[] = {
+	SBIUNIT_TEST_CASE(heap_size_class_test),
+	SBIUNIT_TEST_CASE(heap_reuse_test),
+	SBIUNIT_TEST_CASE(heap_large_aligned_test),
+	SBIUNIT_TEST_CASE(heap_coalesce_test),
+	SBIUNIT_TEST_CASE(heap_exhaust_test),
+	SBIUNIT_TEST_CASE(heap_small_bench),
+	SBIUNIT_TEST_CASE(heap_magazine_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(heap_test_suite, heap_test_cases);
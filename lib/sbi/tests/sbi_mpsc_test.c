@@ -0,0 +1,125 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_mpsc.h>
+#include <sbi/sbi_unit_test.h>
+
+#define MPSC_TEST_ENTRIES	4
+
+struct mpsc_test_entry {
+	unsigned long start;
+	unsigned long size;
+};
+
+static char mpsc_test_mem[SBI_MPSC_MEM_SIZE(MPSC_TEST_ENTRIES,
+					    sizeof(struct mpsc_test_entry))];
+static struct sbi_mpsc mpsc_test_ring;
+
+static void mpsc_test_reset(void)
+{
+	sbi_mpsc_init(&mpsc_test_ring, mpsc_test_mem, MPSC_TEST_ENTRIES,
+		      sizeof(struct mpsc_test_entry));
+}
+
+static void mpsc_order_test(struct sbiunit_test_case *test)
+{
+	struct mpsc_test_entry in, out;
+	unsigned long i, lap;
+
+	mpsc_test_reset();
+	SBIUNIT_EXPECT(test, sbi_mpsc_is_empty(&mpsc_test_ring));
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_dequeue(&mpsc_test_ring, &out),
+			  SBI_ENOENT);
+
+	/* Run several laps to cover wrap-around of slot sequence numbers */
+	for (lap = 0; lap < 3; lap++) {
+		for (i = 0; i < MPSC_TEST_ENTRIES; i++) {
+			in.start = lap * 100 + i;
+			in.size = i;
+			SBIUNIT_EXPECT_EQ(test,
+				sbi_mpsc_enqueue(&mpsc_test_ring, &in), 0);
+		}
+
+		/* Ring is full now */
+		SBIUNIT_EXPECT_EQ(test, sbi_mpsc_enqueue(&mpsc_test_ring, &in),
+				  SBI_ENOSPC);
+
+		for (i = 0; i < MPSC_TEST_ENTRIES; i++) {
+			SBIUNIT_EXPECT_EQ(test,
+				sbi_mpsc_dequeue(&mpsc_test_ring, &out), 0);
+			SBIUNIT_EXPECT_EQ(test, out.start, lap * 100 + i);
+			SBIUNIT_EXPECT_EQ(test, out.size, i);
+		}
+
+		SBIUNIT_EXPECT(test, sbi_mpsc_is_empty(&mpsc_test_ring));
+	}
+}
+
+static int mpsc_test_update_cb(void *in, void *data)
+{
+	struct mpsc_test_entry *next = in, *curr = data;
+
+	if (next->start != curr->start)
+		return SBI_FIFO_UNCHANGED;
+
+	if (next->size > curr->size) {
+		curr->size = next->size;
+		return SBI_FIFO_UPDATED;
+	}
+
+	return SBI_FIFO_SKIP;
+}
+
+static void mpsc_inplace_update_test(struct sbiunit_test_case *test)
+{
+	struct mpsc_test_entry in, out;
+
+	mpsc_test_reset();
+
+	/* Nothing to update in an empty ring */
+	in.start = 1;
+	in.size = 1;
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_inplace_update(&mpsc_test_ring, &in,
+							mpsc_test_update_cb),
+			  SBI_FIFO_UNCHANGED);
+
+	SBIUNIT_ASSERT_EQ(test, sbi_mpsc_enqueue(&mpsc_test_ring, &in), 0);
+	in.start = 2;
+	SBIUNIT_ASSERT_EQ(test, sbi_mpsc_enqueue(&mpsc_test_ring, &in), 0);
+
+	in.size = 8;
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_inplace_update(&mpsc_test_ring, &in,
+							mpsc_test_update_cb),
+			  SBI_FIFO_UPDATED);
+	in.size = 4;
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_inplace_update(&mpsc_test_ring, &in,
+							mpsc_test_update_cb),
+			  SBI_FIFO_SKIP);
+	in.start = 3;
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_inplace_update(&mpsc_test_ring, &in,
+							mpsc_test_update_cb),
+			  SBI_FIFO_UNCHANGED);
+
+	/* Consumed entries must not be visited anymore */
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_dequeue(&mpsc_test_ring, &out), 0);
+	SBIUNIT_EXPECT_EQ(test, out.start, 1);
+	SBIUNIT_EXPECT_EQ(test, out.size, 1);
+	in.start = 1;
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_inplace_update(&mpsc_test_ring, &in,
+							mpsc_test_update_cb),
+			  SBI_FIFO_UNCHANGED);
+
+	SBIUNIT_EXPECT_EQ(test, sbi_mpsc_dequeue(&mpsc_test_ring, &out), 0);
+	SBIUNIT_EXPECT_EQ(test, out.start, 2);
+	SBIUNIT_EXPECT_EQ(test, out.size, 8);
+	SBIUNIT_EXPECT(test, sbi_mpsc_is_empty(&mpsc_test_ring));
+}
+
+static struct sbiunit_test_case mpsc_test_cases[] = {
+	SBIUNIT_TEST_CASE(mpsc_order_test),
+	SBIUNIT_TEST_CASE(mpsc_inplace_update_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(mpsc_test_suite, mpsc_test_cases);
@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_unit_test.h>
+
+#define HARTID_TEST_ROUNDS	64
+
+static u32 hartid_test_scan(u32 hartid)
+{
+	u32 i;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++)
+		if (hartindex_to_hartid_table[i] == hartid)
+			return i;
+
+	return -1U;
+}
+
+static void hartid_lookup_test(struct sbiunit_test_case *test)
+{
+	u32 i, hartid, max_hartid = 0;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++) {
+		hartid = sbi_hartindex_to_hartid(i);
+		if (hartid == -1U)
+			continue;
+		SBIUNIT_EXPECT_EQ(test, sbi_hartid_to_hartindex(hartid),
+				  hartid_test_scan(hartid));
+		if (max_hartid < hartid)
+			max_hartid = hartid;
+	}
+
+	/* HART ids around and beyond the valid ones must not be found */
+	for (hartid = 0; hartid <= max_hartid + 16; hartid++)
+		SBIUNIT_EXPECT_EQ(test, sbi_hartid_to_hartindex(hartid),
+				  hartid_test_scan(hartid));
+	SBIUNIT_EXPECT_EQ(test, sbi_hartid_to_hartindex(-2U), -1U);
+}
+
+static void hartid_linear_test(struct sbiunit_test_case *test)
+{
+	bool linear = true;
+	u32 i, base;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++) {
+		if (sbi_hartindex_to_hartid(i) == -1U ||
+		    sbi_hartindex_to_hartid(i) != sbi_hartindex_to_hartid(0) + i)
+			linear = false;
+	}
+
+	SBIUNIT_EXPECT_EQ(test, sbi_hartid_is_linear(&base), linear);
+	if (linear)
+		SBIUNIT_EXPECT_EQ(test, base, sbi_hartindex_to_hartid(0));
+}
+
+/*
+ * Not a functional test: compare the cycles spent by the HART id lookup
+ * table and a linear scan of hartindex_to_hartid_table for the last HART.
+ */
+static void hartid_lookup_bench(struct sbiunit_test_case *test)
+{
+	u32 i, hartid = sbi_hartindex_to_hartid(sbi_scratch_last_hartindex());
+	volatile u32 sink;
+	unsigned long start, table, scan;
+
+	start = csr_read(CSR_MCYCLE);
+	for (i = 0; i < HARTID_TEST_ROUNDS; i++)
+		sink = sbi_hartid_to_hartindex(hartid);
+	table = csr_read(CSR_MCYCLE) - start;
+
+	start = csr_read(CSR_MCYCLE);
+	for (i = 0; i < HARTID_TEST_ROUNDS; i++)
+		sink = hartid_test_scan(hartid);
+	scan = csr_read(CSR_MCYCLE) - start;
+
+	(void)sink;
+	sbi_printf("%s: %u harts: table %lu cycles, scan %lu cycles\n",
+		   test->name, sbi_scratch_last_hartindex() + 1,
+		   table / HARTID_TEST_ROUNDS, scan / HARTID_TEST_ROUNDS);
+}
+
+static struct sbiunit_test_case scratch_test_cases[] = {
+	SBIUNIT_TEST_CASE(hartid_lookup_test),
+	SBIUNIT_TEST_CASE(hartid_linear_test),
+	SBIUNIT_TEST_CASE(hartid_lookup_bench),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(scratch_test_suite, scratch_test_cases);
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_hfence.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_unit_test.h>
+
+#define TLB_TEST_VA		0x80000000UL
+
+static unsigned long tlb_test_sfence_vma(unsigned long npages)
+{
+	unsigned long i, start;
+
+	start = csr_read(CSR_MCYCLE);
+	for (i = 0; i < npages; i++)
+		__asm__ __volatile__("sfence.vma %0"
+				     :
+				     : "r"(TLB_TEST_VA + i * PAGE_SIZE)
+				     : "memory");
+
+	return csr_read(CSR_MCYCLE) - start;
+}
+
+static unsigned long tlb_test_sinval_vma(unsigned long npages)
+{
+	unsigned long i, start;
+
+	start = csr_read(CSR_MCYCLE);
+	__sbi_sfence_w_inval();
+	for (i = 0; i < npages; i++)
+		__sbi_sinval_vma_va(TLB_TEST_VA + i * PAGE_SIZE);
+	__sbi_sfence_inval_ir();
+
+	return csr_read(CSR_MCYCLE) - start;
+}
+
+/*
+ * Not a functional test: compare the cycles spent by the per-page
+ * SFENCE.VMA loop and the Svinval batched loop for various range sizes.
+ */
+static void tlb_range_flush_bench(struct sbiunit_test_case *test)
+{
+	bool svinval = sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+					      SBI_HART_EXT_SVINVAL);
+	unsigned long npages;
+
+	for (npages = 1; npages <= 512; npages <<= 1) {
+		sbi_printf("%s: %3lu pages: sfence.vma %8lu cycles",
+			   test->name, npages, tlb_test_sfence_vma(npages));
+		if (svinval)
+			sbi_printf(", sinval.vma %8lu cycles",
+				   tlb_test_sinval_vma(npages));
+		sbi_printf("\n");
+	}
+}
+
+static struct sbiunit_test_case tlb_test_cases[] = {
+	SBIUNIT_TEST_CASE(tlb_range_flush_bench),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(tlb_test_suite, tlb_test_cases);
@@ -10,6 +10,7 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_ipi.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_hart.h>
@@ -472,6 +473,69 @@ static int fdt_parse_isa_all_harts(const void *fdt)
 	return 0;
 }
 
+#define FDT_CPU_MAP_MAX_DEPTH		8
+
+static int fdt_parse_cpu_map_node(const void *fdt, int node, int depth,
+				  u32 cluster, u32 *next_cluster)
+{
+	int rc, child, cpu_offset, len;
+	const char *name;
+	const fdt32_t *val;
+	u32 hartid, child_cluster;
+
+	if (FDT_CPU_MAP_MAX_DEPTH < depth)
+		return SBI_EINVAL;
+
+	val = fdt_getprop(fdt, node, "cpu", &len);
+	if (val && len >= sizeof(fdt32_t)) {
+		cpu_offset = fdt_node_offset_by_phandle(fdt, fdt32_to_cpu(*val));
+		if (cpu_offset < 0)
+			return 0;
+
+		rc = fdt_parse_hart_id(fdt, cpu_offset, &hartid);
+		if (rc || !fdt_node_is_enabled(fdt, cpu_offset))
+			return 0;
+
+		sbi_ipi_set_hart_cluster(sbi_hartid_to_hartindex(hartid),
+					 cluster);
+		return 0;
+	}
+
+	fdt_for_each_subnode(child, fdt, node) {
+		name = fdt_get_name(fdt, child, NULL);
+		if (name && !strncmp(name, "cluster", strlen("cluster")))
+			child_cluster = (*next_cluster)++;
+		else
+			child_cluster = cluster;
+
+		rc = fdt_parse_cpu_map_node(fdt, child, depth + 1,
+					    child_cluster, next_cluster);
+		if (rc)
+			return rc;
+	}
+
+	return 0;
+}
+
+int fdt_parse_cpu_map(const void *fdt)
+{
+	int cpus_offset, map_offset;
+	u32 next_cluster = 0;
+
+	if (!fdt)
+		return SBI_EINVAL;
+
+	cpus_offset = fdt_path_offset(fdt, "/cpus");
+	if (cpus_offset < 0)
+		return cpus_offset;
+
+	map_offset = fdt_subnode_offset(fdt, cpus_offset, "cpu-map");
+	if (map_offset < 0)
+		return SBI_ENOENT;
+
+	return fdt_parse_cpu_map_node(fdt, map_offset, 0, 0, &next_cluster);
+}
+
 int fdt_parse_isa_extensions(const void *fdt, unsigned int hartid,
 			unsigned long *extensions)
 {
@@ -12,6 +12,7 @@
 #include <sbi/riscv_io.h>
 #include <sbi/sbi_domain.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
@@ -25,6 +26,9 @@ static unsigned long mswi_ptr_offset;
 #define mswi_set_hart_data_ptr(__scratch, __mswi)			\
 	sbi_scratch_write_type((__scratch), void *, mswi_ptr_offset, (__mswi))
 
+/* MSIP register of each HART index, used for multicast IPIs */
+static u32 *mswi_msip[SBI_HARTMASK_MAX_BITS];
+
 static void mswi_ipi_send(u32 hart_index)
 {
 	u32 *msip;
@@ -45,6 +49,17 @@ static void mswi_ipi_send(u32 hart_index)
 			mswi->first_hartid]);
 }
 
+static void mswi_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i;
+
+	/* Set ACLINT IPIs */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		if (mswi_msip[i])
+			writel_relaxed(1, mswi_msip[i]);
+	}
+}
+
 static void mswi_ipi_clear(void)
 {
 	u32 *msip;
@@ -63,7 +78,8 @@ static void mswi_ipi_clear(void)
 static struct sbi_ipi_device aclint_mswi = {
 	.name = "aclint-mswi",
 	.ipi_send = mswi_ipi_send,
-	.ipi_clear = mswi_ipi_clear
+	.ipi_clear = mswi_ipi_clear,
+	.ipi_send_mask = mswi_ipi_send_mask
 };
 
 int aclint_mswi_cold_init(struct aclint_mswi_data *mswi)
@@ -96,6 +112,7 @@ int aclint_mswi_cold_init(struct aclint_mswi_data *mswi)
 		if (!scratch)
 			continue;
 		mswi_set_hart_data_ptr(scratch, mswi);
+		mswi_msip[scratch->hartindex] = (u32 *)mswi->addr + i;
 	}
 
 	/* Add MSWI regions to the root domain */
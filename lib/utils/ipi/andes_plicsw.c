@@ -13,6 +13,7 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_io.h>
 #include <sbi/sbi_domain.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi_utils/ipi/andes_plicsw.h>
 
@@ -41,6 +42,38 @@ static void plicsw_ipi_send(u32 hart_index)
 	writel_relaxed(BIT(pending_bit), (void *)pending_reg);
 }
 
+static void plicsw_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i, target_hart, interrupt_id, word_index, pending_word = 0;
+	u32 pending_bits = 0;
+
+	/*
+	 * Set the pending bits of all target harts sharing a pending
+	 * register with a single write. Writing zero bits has no effect.
+	 */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		target_hart = sbi_hartindex_to_hartid(i);
+		if (plicsw.hart_count <= target_hart)
+			ebreak();
+
+		interrupt_id = target_hart + 1;
+		word_index   = interrupt_id / 32;
+		if (pending_bits && word_index != pending_word) {
+			writel_relaxed(pending_bits,
+				       (void *)(plicsw.addr + PLICSW_PENDING_BASE +
+						pending_word * 4));
+			pending_bits = 0;
+		}
+		pending_word  = word_index;
+		pending_bits |= BIT(interrupt_id % 32);
+	}
+
+	if (pending_bits)
+		writel_relaxed(pending_bits,
+			       (void *)(plicsw.addr + PLICSW_PENDING_BASE +
+					pending_word * 4));
+}
+
 static void plicsw_ipi_clear(void)
 {
 	u32 target_hart = current_hartid();
@@ -62,7 +95,8 @@ static void plicsw_ipi_clear(void)
 static struct sbi_ipi_device plicsw_ipi = {
 	.name      = "andes_plicsw",
 	.ipi_send  = plicsw_ipi_send,
-	.ipi_clear = plicsw_ipi_clear
+	.ipi_clear = plicsw_ipi_clear,
+	.ipi_send_mask = plicsw_ipi_send_mask
 };
 
 int plicsw_cold_ipi_init(struct plicsw_data *plicsw)
@@ -14,6 +14,7 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_csr_detect.h>
 #include <sbi/sbi_domain.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_irqchip.h>
 #include <sbi/sbi_error.h>
@@ -96,6 +97,27 @@ static unsigned long imsic_file_offset;
 #define imsic_set_hart_file(__scratch, __file)				\
 	sbi_scratch_write_type((__scratch), long, imsic_file_offset, (__file))
 
+/* IPI doorbell register of each HART index, used for multicast IPIs */
+static void *imsic_ipi_reg[SBI_HARTMASK_MAX_BITS];
+
+static void *imsic_ipi_reg_addr(struct imsic_data *data, int file)
+{
+	unsigned long reloff;
+	struct imsic_regs *regs;
+
+	regs = &data->regs[0];
+	reloff = file * (1UL << data->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
+	while (regs->size && (regs->size <= reloff)) {
+		reloff -= regs->size;
+		regs++;
+	}
+
+	if (regs->size && (reloff < regs->size))
+		return (void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE);
+
+	return NULL;
+}
+
 int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 {
 	struct sbi_scratch *scratch;
@@ -116,6 +138,7 @@ int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 
 	imsic_set_hart_data_ptr(scratch, imsic);
 	imsic_set_hart_file(scratch, file);
+	imsic_ipi_reg[scratch->hartindex] = imsic_ipi_reg_addr(imsic, file);
 	return 0;
 }
 
@@ -170,36 +193,37 @@ static int imsic_external_irqfn(void)
 
 static void imsic_ipi_send(u32 hart_index)
 {
-	unsigned long reloff;
-	struct imsic_regs *regs;
 	struct imsic_data *data;
 	struct sbi_scratch *scratch;
-	int file;
+	void *reg;
 
 	scratch = sbi_hartindex_to_scratch(hart_index);
 	if (!scratch)
 		return;
 
 	data = imsic_get_hart_data_ptr(scratch);
-	file = imsic_get_hart_file(scratch);
 	if (!data || !data->targets_mmode)
 		return;
 
-	regs = &data->regs[0];
-	reloff = file * (1UL << data->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
-	while (regs->size && (regs->size <= reloff)) {
-		reloff -= regs->size;
-		regs++;
-	}
+	reg = imsic_ipi_reg_addr(data, imsic_get_hart_file(scratch));
+	if (reg)
+		writel_relaxed(IMSIC_IPI_ID, reg);
+}
 
-	if (regs->size && (reloff < regs->size))
-		writel_relaxed(IMSIC_IPI_ID,
-			(void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE));
+static void imsic_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i;
+
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		if (imsic_ipi_reg[i])
+			writel_relaxed(IMSIC_IPI_ID, imsic_ipi_reg[i]);
+	}
 }
 
 static struct sbi_ipi_device imsic_ipi_device = {
 	.name		= "aia-imsic",
-	.ipi_send	= imsic_ipi_send
+	.ipi_send	= imsic_ipi_send,
+	.ipi_send_mask	= imsic_ipi_send_mask
 };
 
 static void imsic_local_eix_update(unsigned long base_id,
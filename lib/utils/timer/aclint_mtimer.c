@@ -69,6 +69,19 @@ static u64 mtimer_value(void)
 	return mt->time_rd((void *)mt->mtime_addr);
 }
 
+static unsigned long mtimer_value_mmio(void)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct aclint_mtimer_data *mt;
+
+	mt = mtimer_get_hart_data_ptr(scratch);
+	if (!mt || !mt->mtime_size)
+		return 0;
+
+	return mt->mtime_addr |
+	       ((mt->has_64bit_mmio) ? 0 : SBI_TIMER_MMIO_32BIT);
+}
+
 static void mtimer_event_stop(void)
 {
 	u32 target_hart = current_hartid();
@@ -105,6 +118,7 @@ static void mtimer_event_start(u64 next_event)
 static struct sbi_timer_device mtimer = {
 	.name = "aclint-mtimer",
 	.timer_value = mtimer_value,
+	.timer_value_mmio = mtimer_value_mmio,
 	.timer_event_start = mtimer_event_start,
 	.timer_event_stop = mtimer_event_stop
 };
@@ -220,6 +234,7 @@ int aclint_mtimer_cold_init(struct aclint_mtimer_data *mt,
 	if (!mt->mtime_size) {
 		/* Disable reading mtime when mtime is not available */
 		mtimer.timer_value = NULL;
+		mtimer.timer_value_mmio = NULL;
 	}
 
 	/* Add MTIMER regions to the root domain */
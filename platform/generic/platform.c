@@ -13,10 +13,12 @@
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_heap.h>
+#include <sbi/sbi_mpsc.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_system.h>
 #include <sbi/sbi_tlb.h>
+#include <sbi/sbi_trap.h>
 #include <sbi_utils/fdt/fdt_domain.h>
 #include <sbi_utils/fdt/fdt_fixup.h>
 #include <sbi_utils/fdt/fdt_helper.h>
@@ -64,7 +66,14 @@ static u32 fw_platform_calculate_heap_size(u32 hart_count)
 	heap_size = SBI_PLATFORM_DEFAULT_HEAP_SIZE(hart_count);
 
 	/* For TLB fifo */
-	heap_size += SBI_TLB_INFO_SIZE * (hart_count) * (hart_count);
+	heap_size += SBI_MPSC_MEM_SIZE(hart_count, SBI_TLB_INFO_SIZE) *
+		     (hart_count);
+
+	/* For rfence latency statistics */
+	heap_size += SBI_TLB_STATS_HEAP_SIZE * (hart_count);
+
+	/* For trap trace rings */
+	heap_size += SBI_TRAP_TRACE_HEAP_SIZE * (hart_count);
 
 	return BIT_ALIGN(heap_size, HEAP_BASE_ALIGN);
 }
@@ -249,6 +258,9 @@ static int generic_early_init(bool cold_boot)
 	if (cold_boot) {
 		fdt_reset_init(fdt);
 
+		/* Cluster topology is optional and only used for IPI fan-out */
+		fdt_parse_cpu_map(fdt);
+
 		if (semihosting_enabled())
 			rc = semihosting_init();
 		else
@@ -358,8 +370,30 @@ static int generic_domains_init(void)
 
 static u64 generic_tlbr_flush_limit(void)
 {
+	const void *fdt = fdt_get_address();
+	int chosen_offset, config_offset, len;
+	const fdt32_t *val;
+
 	if (generic_plat && generic_plat->tlbr_flush_limit)
 		return generic_plat->tlbr_flush_limit(generic_plat_match);
+
+	/* Get the tlb range flush limit from device tree */
+	chosen_offset = fdt_path_offset(fdt, "/chosen");
+	if (chosen_offset < 0)
+		goto default_config;
+
+	config_offset = fdt_node_offset_by_compatible(fdt, chosen_offset,
+						       "opensbi,config");
+	if (config_offset < 0)
+		goto default_config;
+
+	val = fdt_getprop(fdt, config_offset, "tlb-range-flush-limit", &len);
+	if (val && len == sizeof(fdt64_t))
+		return fdt64_ld((const fdt64_t *)val);
+	if (val && len == sizeof(fdt32_t))
+		return fdt32_to_cpu(*val);
+
+default_config:
 	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
 }
 